@@ -0,0 +1,24 @@
+# Benchmarks: `make bench` builds the native driver from the core sources
+# (no PHP API, virtual transport) and runs it, then runs the PHP benchmark
+# scripts against the freshly built extension. Results are JSON lines.
+
+SSD1306_BENCH_SOURCES = \
+	$(srcdir)/bench/bench.c \
+	$(srcdir)/ssd1306_display.c \
+	$(srcdir)/ssd1306_graphics.c \
+	$(srcdir)/ssd1306_async.c \
+	$(srcdir)/ssd1306_shared.c \
+	$(srcdir)/ssd1306_virtual.c
+
+$(builddir)/bench/ssd1306_bench: $(SSD1306_BENCH_SOURCES) $(srcdir)/php_ssd1306.h
+	@mkdir -p $(builddir)/bench
+	$(CC) $(COMMON_FLAGS) $(CFLAGS_CLEAN) $(EXTRA_CFLAGS) -DSSD1306_NO_PHP_API -I$(srcdir) \
+		-o $@ $(SSD1306_BENCH_SOURCES) $(SSD1306_SHARED_LIBADD) -lm
+
+bench: all $(builddir)/bench/ssd1306_bench
+	$(builddir)/bench/ssd1306_bench
+	@for script in $(srcdir)/bench/primitives.php $(srcdir)/bench/flush.php; do \
+		$(PHP_EXECUTABLE) -n -d extension_dir=$(phplibdir) -d extension=ssd1306 $$script || exit 1; \
+	done
+
+.PHONY: bench
@@ -0,0 +1,295 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP SSD1306 Extension - Native Benchmark Driver                     |
+  +----------------------------------------------------------------------+
+  | Copyright (c) Project Saturn Studios, LLC                           |
+  +----------------------------------------------------------------------+
+*/
+
+/*
+ * Measures the rasterizer and the flush path without PHP or hardware:
+ * primitives per second for each drawing routine, and frames per second
+ * for full and partial updates against the virtual transport. Built and
+ * run by `make bench` with SSD1306_NO_PHP_API, so only the core sources
+ * are linked.
+ *
+ * Each result is one JSON object per line:
+ *   {"suite":"native","version":"1.0.0","bench":"line","unit":"ops/s",
+ *    "ops":123456,"seconds":0.500,"rate":246912.0}
+ * Flush results add "bytes_per_op". SSD1306_BENCH_TIME sets the minimum
+ * time per benchmark in seconds (default 0.5); arguments restrict the run
+ * to the named benchmarks.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_ssd1306.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_BATCH 256
+
+static ssd1306_t bench_display;
+static unsigned int bench_seed = 1;
+
+/* Small LCG so runs draw the same shapes everywhere */
+static int bench_rand(int range)
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return (int) ((bench_seed >> 16) % (unsigned int) range);
+}
+
+static void bench_pixel(ssd1306_t *d)
+{
+    ssd1306_set_pixel_internal(d, bench_rand(d->width), bench_rand(d->height), SSD1306_INVERSE);
+}
+
+static void bench_line(ssd1306_t *d)
+{
+    ssd1306_draw_line_internal(d, bench_rand(d->width), bench_rand(d->height),
+                               bench_rand(d->width), bench_rand(d->height), SSD1306_INVERSE);
+}
+
+static void bench_hline(ssd1306_t *d)
+{
+    int y = bench_rand(d->height);
+    ssd1306_draw_line_internal(d, 0, y, d->width - 1, y, SSD1306_INVERSE);
+}
+
+static void bench_vline(ssd1306_t *d)
+{
+    int x = bench_rand(d->width);
+    ssd1306_draw_line_internal(d, x, 0, x, d->height - 1, SSD1306_INVERSE);
+}
+
+static void bench_rect(ssd1306_t *d)
+{
+    ssd1306_draw_rect_internal(d, bench_rand(d->width - 40), bench_rand(d->height - 20), 40, 20, SSD1306_INVERSE);
+}
+
+static void bench_fill_rect(ssd1306_t *d)
+{
+    ssd1306_fill_rect_internal(d, bench_rand(d->width - 40), bench_rand(d->height - 20), 40, 20, SSD1306_INVERSE);
+}
+
+static void bench_clear(ssd1306_t *d)
+{
+    ssd1306_fill_rect_internal(d, 0, 0, d->width, d->height, SSD1306_BLACK);
+}
+
+static void bench_circle(ssd1306_t *d)
+{
+    ssd1306_draw_circle_internal(d, bench_rand(d->width), bench_rand(d->height), 20, SSD1306_INVERSE);
+}
+
+static void bench_fill_circle(ssd1306_t *d)
+{
+    ssd1306_fill_circle_internal(d, bench_rand(d->width), bench_rand(d->height), 20, SSD1306_INVERSE);
+}
+
+static void bench_ellipse(ssd1306_t *d)
+{
+    ssd1306_draw_ellipse_internal(d, bench_rand(d->width), bench_rand(d->height), 30, 15, SSD1306_INVERSE);
+}
+
+static void bench_fill_ellipse(ssd1306_t *d)
+{
+    ssd1306_fill_ellipse_internal(d, bench_rand(d->width), bench_rand(d->height), 30, 15, SSD1306_INVERSE);
+}
+
+static void bench_fill_round_rect(ssd1306_t *d)
+{
+    ssd1306_fill_round_rect_internal(d, bench_rand(d->width - 40), bench_rand(d->height - 20), 40, 20, 6, SSD1306_INVERSE);
+}
+
+static void bench_glyph(ssd1306_t *d)
+{
+    ssd1306_draw_char_internal(d, bench_rand(d->width - 6), bench_rand(d->height - 8),
+                               'A' + bench_rand(26), SSD1306_WHITE, SSD1306_BLACK, 1);
+}
+
+static void bench_glyph_2x(ssd1306_t *d)
+{
+    ssd1306_draw_char_internal(d, bench_rand(d->width - 12), bench_rand(d->height - 16),
+                               'A' + bench_rand(26), SSD1306_WHITE, SSD1306_BLACK, 2);
+}
+
+/* A 16x16 icon in each source layout: 32 bytes of rows or of pages */
+static const unsigned char bench_icon[32] = {
+    0x07, 0xE0, 0x18, 0x18, 0x20, 0x04, 0x4C, 0x32, 0x4C, 0x32, 0x80, 0x01, 0x80, 0x01, 0x80, 0x01,
+    0x88, 0x11, 0x84, 0x21, 0x43, 0xC2, 0x40, 0x02, 0x20, 0x04, 0x18, 0x18, 0x07, 0xE0, 0x00, 0x00,
+};
+
+static void bench_bitmap(ssd1306_t *d)
+{
+    ssd1306_draw_bitmap_internal(d, bench_rand(d->width - 16), bench_rand(d->height - 16), bench_icon, NULL,
+                                 16, 16, SSD1306_FORMAT_ROW, SSD1306_WHITE, SSD1306_BLACK);
+}
+
+static void bench_bitmap_page(ssd1306_t *d)
+{
+    ssd1306_draw_bitmap_internal(d, bench_rand(d->width - 16), bench_rand(d->height - 16), bench_icon, NULL,
+                                 16, 16, SSD1306_FORMAT_PAGE, SSD1306_WHITE, SSD1306_BLACK);
+}
+
+/* A 32x32 block moved by an offset that is not a whole number of pages */
+static void bench_copy_rect(ssd1306_t *d)
+{
+    ssd1306_copy_rect_internal(d, bench_rand(d->width - 32), bench_rand(d->height - 32), 32, 32,
+                               bench_rand(d->width - 32), bench_rand(d->height - 32));
+}
+
+/* A full screen log view scrolled up one row */
+static void bench_scroll_region(ssd1306_t *d)
+{
+    ssd1306_scroll_region_internal(d, 0, 0, d->width, d->height, 0, -1, SSD1306_BLACK);
+}
+
+static void bench_text(ssd1306_t *d)
+{
+    static const char line[] = "The quick brown fox j";  /* One 21 column line */
+
+    d->cursor_x = 0;
+    d->cursor_y = bench_rand(d->pages) * 8;
+    ssd1306_print_internal(d, line, sizeof(line) - 1);
+}
+
+static void bench_flush_full(ssd1306_t *d)
+{
+    ssd1306_update_display(d, 1);
+}
+
+static void bench_flush_partial(ssd1306_t *d)
+{
+    /* A spinner-sized change: a few pixels in one corner */
+    for (int i = 0; i < 8; i++) {
+        ssd1306_set_pixel_internal(d, 100 + bench_rand(8), bench_rand(8), SSD1306_INVERSE);
+    }
+    ssd1306_update_display(d, 0);
+}
+
+static void bench_flush_text(ssd1306_t *d)
+{
+    /* A status line rewritten every frame */
+    char line[22];
+
+    snprintf(line, sizeof(line), "%08u", bench_seed);
+    bench_rand(2);
+    d->cursor_x = 0;
+    d->cursor_y = 0;
+    ssd1306_print_internal(d, line, strlen(line));
+    ssd1306_update_display(d, 0);
+}
+
+static void bench_flush_idle(ssd1306_t *d)
+{
+    ssd1306_update_display(d, 0);
+}
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    void (*op)(ssd1306_t *display);
+    int flush;                  /* Report bus bytes per operation */
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    {"pixel",            "ops/s",    bench_pixel,            0},
+    {"line",             "ops/s",    bench_line,             0},
+    {"hline",            "ops/s",    bench_hline,            0},
+    {"vline",            "ops/s",    bench_vline,            0},
+    {"rect",             "ops/s",    bench_rect,             0},
+    {"fill_rect",        "ops/s",    bench_fill_rect,        0},
+    {"clear",            "ops/s",    bench_clear,            0},
+    {"circle",           "ops/s",    bench_circle,           0},
+    {"fill_circle",      "ops/s",    bench_fill_circle,      0},
+    {"ellipse",          "ops/s",    bench_ellipse,          0},
+    {"fill_ellipse",     "ops/s",    bench_fill_ellipse,     0},
+    {"fill_round_rect",  "ops/s",    bench_fill_round_rect,  0},
+    {"glyph",            "ops/s",    bench_glyph,            0},
+    {"glyph_2x",         "ops/s",    bench_glyph_2x,         0},
+    {"bitmap",           "ops/s",    bench_bitmap,           0},
+    {"bitmap_page",      "ops/s",    bench_bitmap_page,      0},
+    {"copy_rect",        "ops/s",    bench_copy_rect,        0},
+    {"scroll_region",    "ops/s",    bench_scroll_region,    0},
+    {"text",             "ops/s",    bench_text,             0},
+    {"flush_full",       "frames/s", bench_flush_full,       1},
+    {"flush_partial",    "frames/s", bench_flush_partial,    1},
+    {"flush_text",       "frames/s", bench_flush_text,       1},
+    {"flush_idle",       "frames/s", bench_flush_idle,       1},
+};
+
+static int bench_selected(const char *name, int argc, char **argv)
+{
+    if (argc < 2) {
+        return 1;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void bench_run(ssd1306_t *d, const bench_case_t *bench, double min_seconds)
+{
+    uint64_t limit = (uint64_t) (min_seconds * 1e9);
+    unsigned long ops = 0, start_bytes;
+    uint64_t start, elapsed;
+
+    /* Same shapes and a panel in sync for every run */
+    bench_seed = 1;
+    memset(d->buffer, 0, d->buffer_size);
+    ssd1306_mark_all_dirty(d);
+    ssd1306_update_display(d, 1);
+
+    start_bytes = d->bytes_sent;
+    start = ssd1306_now_ns();
+    do {
+        for (int i = 0; i < BENCH_BATCH; i++) {
+            bench->op(d);
+        }
+        ops += BENCH_BATCH;
+        elapsed = ssd1306_now_ns() - start;
+    } while (elapsed < limit);
+
+    printf("{\"suite\":\"native\",\"version\":\"%s\",\"bench\":\"%s\",\"unit\":\"%s\","
+           "\"ops\":%lu,\"seconds\":%.3f,\"rate\":%.1f",
+           PHP_SSD1306_VERSION, bench->name, bench->unit, ops, elapsed / 1e9, ops * 1e9 / elapsed);
+    if (bench->flush) {
+        printf(",\"bytes_per_op\":%.1f", (double) (d->bytes_sent - start_bytes) / ops);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *env = getenv("SSD1306_BENCH_TIME");
+    double min_seconds = env ? atof(env) : 0.5;
+
+    if (min_seconds <= 0) {
+        min_seconds = 0.5;
+    }
+
+    if (ssd1306_init(&bench_display, &ssd1306_transport_virtual, 0, SSD1306_I2C_ADDRESS,
+                     SSD1306_LCDWIDTH_128, SSD1306_LCDHEIGHT_64, SSD1306_SWITCHCAPVCC) != 0) {
+        fprintf(stderr, "ssd1306_bench: cannot open the virtual panel\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+        if (bench_selected(bench_cases[i].name, argc, argv)) {
+            bench_run(&bench_display, &bench_cases[i], min_seconds);
+        }
+    }
+
+    ssd1306_cleanup(&bench_display);
+    return 0;
+}
@@ -0,0 +1,62 @@
+<?php
+/**
+ * Shared helpers for the PHP benchmarks
+ *
+ * Results are printed as one JSON object per line, in the same format as
+ * the native driver (bench/bench.c) with "suite":"php", so both can be
+ * collected into one file and compared across releases.
+ * SSD1306_BENCH_TIME sets the minimum time per benchmark in seconds.
+ */
+
+if (!extension_loaded('ssd1306')) {
+    fwrite(STDERR, "The ssd1306 extension is not loaded\n");
+    exit(1);
+}
+
+const BENCH_BATCH = 64;
+
+/**
+ * Open a 128x64 virtual panel; benchmarks never need hardware
+ */
+function bench_display(): SSD1306\Display
+{
+    return new SSD1306\Display(0, SSD1306_I2C_ADDRESS, 128, 64, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+}
+
+/**
+ * Call $op in batches for at least the configured time and print the rate
+ */
+function bench_run(SSD1306\Display $display, string $name, string $unit, callable $op, bool $flush = false): void
+{
+    $limit = (float) (getenv('SSD1306_BENCH_TIME') ?: 0.5);
+
+    mt_srand(1);
+    $display->clearDisplay();
+    $display->display(true);
+    $startBytes = $display->stats()['bytes_sent'];
+
+    $ops = 0;
+    $start = hrtime(true);
+    do {
+        for ($i = 0; $i < BENCH_BATCH; $i++) {
+            $op($display);
+        }
+        $ops += BENCH_BATCH;
+        $elapsed = (hrtime(true) - $start) / 1e9;
+    } while ($elapsed < $limit);
+
+    $result = [
+        'suite' => 'php',
+        'version' => phpversion('ssd1306'),
+        'bench' => $name,
+        'unit' => $unit,
+        'ops' => $ops,
+        'seconds' => round($elapsed, 3),
+        'rate' => round($ops / $elapsed, 1),
+    ];
+    if ($flush) {
+        $result['bytes_per_op'] = round(($display->stats()['bytes_sent'] - $startBytes) / $ops, 1);
+    }
+
+    echo json_encode($result), "\n";
+}
@@ -0,0 +1,35 @@
+<?php
+/**
+ * Display updates per second through the PHP API, with the bus bytes each
+ * one costs
+ */
+
+require __DIR__ . '/common.php';
+
+$oled = bench_display();
+
+bench_run($oled, 'flush_full', 'frames/s', function ($d) {
+    $d->display(true);
+}, true);
+
+bench_run($oled, 'flush_partial', 'frames/s', function ($d) {
+    for ($i = 0; $i < 8; $i++) {
+        $d->drawPixel(100 + mt_rand(0, 7), mt_rand(0, 7), SSD1306_INVERSE);
+    }
+    $d->display();
+}, true);
+
+bench_run($oled, 'flush_text', 'frames/s', function ($d) {
+    $d->setCursor(0, 0);
+    $d->print(sprintf('%08d', mt_rand()));
+    $d->display();
+}, true);
+
+bench_run($oled, 'flush_idle', 'frames/s', function ($d) {
+    $d->display();
+}, true);
+
+bench_run($oled, 'flush_async', 'frames/s', function ($d) {
+    $d->drawPixel(mt_rand(0, 127), mt_rand(0, 63), SSD1306_INVERSE);
+    $d->displayAsync();
+}, true);
@@ -0,0 +1,87 @@
+<?php
+/**
+ * Drawing primitives per second through the PHP API
+ */
+
+require __DIR__ . '/common.php';
+
+$oled = bench_display();
+$w = $oled->getWidth();
+$h = $oled->getHeight();
+
+bench_run($oled, 'pixel', 'ops/s', function ($d) use ($w, $h) {
+    $d->drawPixel(mt_rand(0, $w - 1), mt_rand(0, $h - 1), SSD1306_INVERSE);
+});
+
+bench_run($oled, 'line', 'ops/s', function ($d) use ($w, $h) {
+    $d->drawLine(mt_rand(0, $w - 1), mt_rand(0, $h - 1), mt_rand(0, $w - 1), mt_rand(0, $h - 1), SSD1306_INVERSE);
+});
+
+bench_run($oled, 'rect', 'ops/s', function ($d) use ($w, $h) {
+    $d->drawRect(mt_rand(0, $w - 40), mt_rand(0, $h - 20), 40, 20, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'fill_rect', 'ops/s', function ($d) use ($w, $h) {
+    $d->fillRect(mt_rand(0, $w - 40), mt_rand(0, $h - 20), 40, 20, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'clear', 'ops/s', function ($d) {
+    $d->clearDisplay();
+});
+
+bench_run($oled, 'circle', 'ops/s', function ($d) use ($w, $h) {
+    $d->drawCircle(mt_rand(0, $w - 1), mt_rand(0, $h - 1), 20, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'fill_circle', 'ops/s', function ($d) use ($w, $h) {
+    $d->fillCircle(mt_rand(0, $w - 1), mt_rand(0, $h - 1), 20, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'ellipse', 'ops/s', function ($d) use ($w, $h) {
+    $d->drawEllipse(mt_rand(0, $w - 1), mt_rand(0, $h - 1), 30, 15, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'fill_ellipse', 'ops/s', function ($d) use ($w, $h) {
+    $d->fillEllipse(mt_rand(0, $w - 1), mt_rand(0, $h - 1), 30, 15, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'fill_round_rect', 'ops/s', function ($d) use ($w, $h) {
+    $d->fillRoundRect(mt_rand(0, $w - 40), mt_rand(0, $h - 20), 40, 20, 6, SSD1306_INVERSE);
+});
+
+bench_run($oled, 'glyph', 'ops/s', function ($d) use ($w, $h) {
+    $d->setCursor(mt_rand(0, $w - 6), mt_rand(0, $h - 8));
+    $d->print(chr(mt_rand(65, 90)));
+});
+
+$icon = str_repeat("\x3c\x42\x81\x81\x81\x81\x42\x3c", 4);
+bench_run($oled, 'bitmap', 'ops/s', function ($d) use ($w, $h, $icon) {
+    $d->drawBitmap(mt_rand(0, $w - 16), mt_rand(0, $h - 16), $icon, 16, 16, SSD1306_WHITE, SSD1306_BLACK);
+});
+
+bench_run($oled, 'scroll_region', 'ops/s', function ($d) use ($w, $h) {
+    $d->scrollRegion(0, 0, $w, $h, 0, -1);
+});
+
+// Sixty-four pixels per call, as an array and as a packed string
+$batch = [];
+$packed = '';
+for ($i = 0; $i < 64; $i++) {
+    $x = mt_rand(0, $w - 1);
+    $y = mt_rand(0, $h - 1);
+    $batch[] = [SSD1306_DRAW_PIXEL, $x, $y, SSD1306_INVERSE];
+    $packed .= pack('Cv3', SSD1306_DRAW_PIXEL, $x, $y, SSD1306_INVERSE);
+}
+
+bench_run($oled, 'batch_pixel_64', 'batches/s', function ($d) use ($batch) {
+    $d->drawBatch($batch);
+});
+
+bench_run($oled, 'packed_pixel_64', 'batches/s', function ($d) use ($packed) {
+    $d->drawBatch($packed);
+});
+
+bench_run($oled, 'text', 'ops/s', function ($d) use ($h) {
+    $d->setCursor(0, mt_rand(0, $h / 8 - 1) * 8);
+    $d->print("The quick brown fox j");
+});
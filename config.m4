@@ -6,7 +6,7 @@ PHP_ARG_ENABLE([ssd1306],
 
 if test "$PHP_SSD1306" != "no"; then
   dnl Check for required headers
-  AC_CHECK_HEADERS([fcntl.h unistd.h sys/ioctl.h linux/i2c-dev.h], [], [
+  AC_CHECK_HEADERS([fcntl.h unistd.h sys/ioctl.h linux/i2c.h linux/i2c-dev.h], [], [
     AC_MSG_ERROR([Required headers not found])
   ])
 
@@ -14,11 +14,33 @@ if test "$PHP_SSD1306" != "no"; then
   PHP_NEW_EXTENSION(ssd1306, 
     ssd1306.c \
     ssd1306_display.c \
-    ssd1306_graphics.c,
+    ssd1306_graphics.c \
+    ssd1306_async.c \
+    ssd1306_shared.c \
+    ssd1306_virtual.c,
     $ext_shared,, -DZEND_ENABLE_STATIC_TSRMLS_CACHE=1)
   
   dnl Add compiler flags
   PHP_ADD_BUILD_DIR($ext_builddir)
+
+  dnl Background flush worker
+  AC_CHECK_HEADERS([pthread.h], [], [
+    AC_MSG_ERROR([pthread.h not found])
+  ])
+  PHP_ADD_LIBRARY(pthread, 1, SSD1306_SHARED_LIBADD)
+
+  dnl Shared framebuffer (shm_open lives in librt on older glibc)
+  AC_CHECK_FUNC(shm_open, [], [
+    PHP_CHECK_LIBRARY(rt, shm_open, [
+      PHP_ADD_LIBRARY(rt, 1, SSD1306_SHARED_LIBADD)
+    ], [
+      AC_MSG_ERROR([shm_open not found])
+    ])
+  ])
+  PHP_SUBST(SSD1306_SHARED_LIBADD)
+
+  dnl Benchmarks (make bench)
+  PHP_ADD_MAKEFILE_FRAGMENT
   
   dnl Check for I2C support
   AC_MSG_CHECKING([for I2C support])
@@ -0,0 +1,53 @@
+<?php
+/**
+ * SSD1306 Event Loop Demo
+ *
+ * This example drives the display from a stream_select() loop without ever
+ * blocking on the I2C bus. The same stream can be registered with
+ * ReactPHP, Amp or Swoole as a readable stream.
+ */
+
+// Initialize the display
+if (!ssd1306_begin()) {
+    die("Failed to initialize SSD1306 display\n");
+}
+
+echo "SSD1306 Event Loop Demo\n";
+
+// Readable whenever a background update or command batch finishes
+$completions = ssd1306_completion_stream();
+
+$frame = 0;
+$inFlight = false;
+$deadline = microtime(true) + 10;
+
+while (microtime(true) < $deadline) {
+    // Render and queue the next frame once the previous one is on the panel
+    if (!$inFlight) {
+        ssd1306_clear_display();
+        ssd1306_set_cursor(0, 0);
+        ssd1306_set_text_size(2);
+        ssd1306_print("Frame\n" . $frame++);
+        ssd1306_display_async();
+        $inFlight = true;
+    }
+
+    // Other sockets would be added to the same select
+    $read = [$completions];
+    $write = $except = null;
+    if (stream_select($read, $write, $except, 0, 100000) > 0) {
+        foreach (ssd1306_completions() as $done) {
+            if (!$done['ok']) {
+                echo "Update failed: {$done['error']}\n";
+            }
+            if ($done['op'] === SSD1306_OP_DISPLAY) {
+                $inFlight = false;
+            }
+        }
+    }
+}
+
+ssd1306_end();
+
+echo "Demo completed!\n";
+?>
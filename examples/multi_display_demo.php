@@ -0,0 +1,46 @@
+<?php
+/**
+ * SSD1306 Multi-Display Demo
+ *
+ * This example drives two panels on the same bus (0x3C and 0x3D) and a third
+ * on another bus. Each SSD1306\Display has its own buffer, cursor and text
+ * state, and releases its panel as soon as the object goes away.
+ */
+
+echo "SSD1306 Multi-Display Demo\n";
+
+try {
+    $panels = [
+        'left'  => new SSD1306\Display(7, SSD1306_I2C_ADDRESS),
+        'right' => new SSD1306\Display(7, SSD1306_I2C_ADDRESS_ALT),
+        'aux'   => new SSD1306\Display(1, SSD1306_I2C_ADDRESS, 128, 32),
+    ];
+} catch (RuntimeException $e) {
+    die($e->getMessage() . "\n");
+}
+
+for ($i = 0; $i < 50; $i++) {
+    foreach ($panels as $name => $panel) {
+        $panel->clearDisplay();
+        $panel->setCursor(0, 0);
+        $panel->setTextSize(1);
+        $panel->print(strtoupper($name) . "\n");
+        $panel->setTextSize(2);
+        $panel->print((string) $i);
+        $panel->drawRect(0, 0, $panel->getWidth(), $panel->getHeight(), SSD1306_WHITE);
+
+        // Panels on different buses are updated in parallel
+        $panel->displayAsync();
+    }
+
+    foreach ($panels as $panel) {
+        $panel->wait();
+    }
+    usleep(100000);
+}
+
+// Releases all three panels
+$panels = null;
+
+echo "Demo completed!\n";
+?>
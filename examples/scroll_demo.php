@@ -59,6 +59,21 @@ echo "Starting diagonal scroll left...\n";
 ssd1306_start_scroll_diag_left(0x00, 0x07);
 sleep(3);
 
+// Stop scrolling
+ssd1306_stop_scroll();
+sleep(1);
+
+echo "Fast marquee on the top page, with updates below it...\n";
+ssd1306_start_scroll(SSD1306_SCROLL_LEFT, 0, 0, 2);
+for ($i = 3; $i > 0; $i--) {
+    // Each update pauses the marquee only while panel RAM is written
+    ssd1306_fill_rect(0, 32, 128, 8, SSD1306_BLACK);
+    ssd1306_set_cursor(0, 32);
+    ssd1306_print("Seconds left: $i");
+    ssd1306_display();
+    sleep(1);
+}
+
 // Stop scrolling
 ssd1306_stop_scroll();
 
@@ -0,0 +1,34 @@
+<?php
+/**
+ * SSD1306 Shared Framebuffer Flusher
+ *
+ * Run this once per panel (e.g. as a systemd service). It is the only
+ * process that talks to /dev/i2c-N; FPM workers and cron jobs draw into the
+ * shared framebuffer with ssd1306_shared_begin() and the normal API:
+ *
+ *   ssd1306_shared_begin('oled');
+ *   ssd1306_clear_display();
+ *   ssd1306_print("Hello from " . getmypid());
+ *   ssd1306_display();          // publishes, returns immediately
+ */
+
+$name = $argv[1] ?? 'oled';
+
+if (!ssd1306_begin(7, SSD1306_I2C_ADDRESS)) {
+    die("Failed to initialize SSD1306 display\n");
+}
+
+if (!ssd1306_shared_serve($name)) {
+    die("Could not serve shared display '$name'\n");
+}
+
+echo "Flushing shared display '$name' (Ctrl+C to stop)\n";
+
+// The native flusher thread does the work; just report now and then
+while (true) {
+    sleep(10);
+    $stats = ssd1306_stats();
+    printf("frames published: %d, flushed: %d, bus bytes: %d\n",
+        $stats['shared_sequence'], $stats['shared_flushed'], $stats['bytes_sent']);
+}
+?>
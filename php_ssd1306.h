@@ -36,6 +36,9 @@ extern zend_module_entry ssd1306_module_entry;
 #include "TSRM.h"
 #endif
 
+#include <pthread.h>
+#include <stdint.h>
+
 /* SSD1306 Constants */
 #define SSD1306_I2C_ADDRESS         0x3C
 #define SSD1306_I2C_ADDRESS_ALT     0x3D
@@ -80,6 +83,7 @@ extern zend_module_entry ssd1306_module_entry;
 #define SSD1306_SETLOWCOLUMN        0x00
 #define SSD1306_SETHIGHCOLUMN       0x10
 #define SSD1306_SETSTARTLINE        0x40
+#define SSD1306_NOP                 0xE3
 
 /* Scrolling commands */
 #define SSD1306_RIGHT_HORIZONTAL_SCROLL              0x26
@@ -90,45 +94,297 @@ extern zend_module_entry ssd1306_module_entry;
 #define SSD1306_ACTIVATE_SCROLL                       0x2F
 #define SSD1306_SET_VERTICAL_SCROLL_AREA              0xA3
 
-/* Structure to hold SSD1306 display state */
+/* Largest command list sent in a single bus transaction */
+#define SSD1306_MAX_COMMANDS        32
+
+/* Largest bitmap width or height, keeping data sizes within 32 bits */
+#define SSD1306_MAX_BITMAP          0x7FFF
+
+/* Transfer strategies */
+#define SSD1306_XFER_WRITE          0   /* One write() per message */
+#define SSD1306_XFER_RDWR           1   /* I2C_RDWR messages of bounded size */
+#define SSD1306_XFER_SMBUS          2   /* SMBus I2C block writes */
+
+/* Transports selectable from ssd1306_begin() */
+#define SSD1306_TRANSPORT_I2C       0   /* Linux i2c-dev character device */
+#define SSD1306_TRANSPORT_VIRTUAL   1   /* In-memory panel that records every transaction */
+
+/* Framebuffer layouts for ssd1306_get_buffer()/ssd1306_set_buffer() and
+   bitmap data layouts for ssd1306_draw_bitmap() */
+#define SSD1306_FORMAT_PAGE         0   /* Native: one byte per column of each 8-row page */
+#define SSD1306_FORMAT_ROW          1   /* Packed rows, leftmost pixel in the MSB (Adafruit GFX) */
+#define SSD1306_FORMAT_XBM          2   /* Packed rows, leftmost pixel in the LSB (XBM) */
+#define SSD1306_FORMAT_BYTE         3   /* One byte per pixel in row order, nonzero is lit */
+
+/* Primitives of a ssd1306_draw_batch() list */
+#define SSD1306_DRAW_PIXEL          1   /* x, y, color */
+#define SSD1306_DRAW_LINE           2   /* x0, y0, x1, y1, color */
+#define SSD1306_DRAW_HLINE          3   /* x, y, w, color */
+#define SSD1306_DRAW_VLINE          4   /* x, y, h, color */
+#define SSD1306_DRAW_RECT           5   /* x, y, w, h, color */
+#define SSD1306_DRAW_FILL_RECT      6   /* x, y, w, h, color */
+#define SSD1306_DRAW_CIRCLE         7   /* x, y, r, color */
+#define SSD1306_DRAW_FILL_CIRCLE    8   /* x, y, r, color */
+#define SSD1306_DRAW_CHAR           9   /* x, y, char, color [, bg [, size]] */
+#define SSD1306_DRAW_TEXT           10  /* x, y, text */
+#define SSD1306_DRAW_BITMAP         11  /* x, y, data, w, h, color [, bg [, format [, mask]]] */
+
+/* Motions of the hardware scroll engine for ssd1306_start_scroll() */
+#define SSD1306_SCROLL_RIGHT        0   /* Pages move right */
+#define SSD1306_SCROLL_LEFT         1   /* Pages move left */
+#define SSD1306_SCROLL_DIAG_RIGHT   2   /* Right, and the scroll area moves up */
+#define SSD1306_SCROLL_DIAG_LEFT    3   /* Left, and the scroll area moves up */
+
+/* Longest scroll setup: deactivate, area, diagonal setup, activate */
+#define SSD1306_SCROLL_SETUP        11
+
+/* Background operations reported on the completion channel */
+#define SSD1306_OP_DISPLAY          1
+#define SSD1306_OP_COMMANDS         2
+
+/* Command bytes that can wait for the background worker */
+#define SSD1306_ASYNC_COMMANDS      256
+
+/* Bytes reserved in front of the display buffer for the data control byte */
+#define SSD1306_BUFFER_HEADROOM     1
+
+/* Flush latency histogram: bucket n counts updates that took less than
+   2^(n+1) microseconds; the last bucket also takes everything slower */
+#define SSD1306_LATENCY_BUCKETS     24
+
+/* Transport and render instrumentation. Collection is a few monotonic
+   clock reads and additions, so it is always on. */
 typedef struct {
+    unsigned long transactions;     /* Bus writes that succeeded */
+    unsigned long write_errors;     /* Bus writes that failed */
+    unsigned long flush_errors;     /* Updates that did not reach the panel */
+    uint64_t io_ns;                 /* Time spent inside transport writes */
+    uint64_t flush_ns;              /* Time spent in updates, diffing included */
+    uint64_t flush_max_ns;          /* Slowest update */
+    uint64_t render_ns;             /* Time spent drawing into the buffer */
+    unsigned long render_calls;     /* Drawing calls timed */
+    unsigned long flush_hist[SSD1306_LATENCY_BUCKETS];
+} ssd1306_metrics_t;
+
+/* Completion record written to the notification pipe, in host byte order
+   (unpack format "Cop/Cok/x2/lerrno/Qbytes") */
+typedef struct {
+    uint8_t op;              /* SSD1306_OP_* */
+    uint8_t ok;              /* 1 if the operation reached the panel */
+    uint16_t reserved;
+    int32_t error;           /* errno of a failed transfer */
+    uint64_t bytes;          /* Bus bytes the operation sent */
+} ssd1306_completion_t;
+
+/* Shared framebuffer segment (ssd1306_shared.c) */
+typedef struct ssd1306_shm ssd1306_shm_t;
+
+typedef struct _ssd1306_t ssd1306_t;
+
+/* Drawing coordinate: holds any zend_long, so arguments reach the clipper
+   untruncated */
+typedef int64_t ssd1306_coord_t;
+
+/* One decoded ssd1306_draw_batch() primitive. arg holds the numeric
+   arguments in list order with the strings taken out; argc counts them,
+   so optional ones can take their defaults. */
+typedef struct {
+    int op;                          /* SSD1306_DRAW_* */
+    int argc;
+    ssd1306_coord_t arg[8];
+    const unsigned char *data;       /* Glyph, text or bitmap bytes */
+    size_t data_len;
+    const unsigned char *mask;       /* Bitmap mask, NULL for none */
+    size_t mask_len;
+} ssd1306_draw_op_t;
+
+/* Parameters of the hardware scroll engine */
+typedef struct {
+    int direction;           /* SSD1306_SCROLL_* */
+    int start_page;          /* Pages moved, inclusive */
+    int end_page;
+    int frames;              /* Frames per step: 2, 3, 4, 5, 25, 64, 128 or 256 */
+    int vertical_offset;     /* Rows per step of a diagonal scroll */
+    int area_top;            /* Vertical scroll area of a diagonal scroll */
+    int area_rows;
+    int start_column;        /* Columns of a horizontal scroll, -1 for the */
+    int end_column;          /*   dummy bytes of controllers without them */
+} ssd1306_scroll_t;
+
+/* Receives the position and reason of each batch primitive that failed */
+typedef void (*ssd1306_draw_error_t)(void *ctx, size_t index, const char *message);
+
+/* How messages reach the panel. write() gets one complete message with the
+   control byte first and is called with the bus lock held. */
+typedef struct {
+    const char *name;
+    int (*open)(ssd1306_t *display, int i2c_bus, int i2c_addr);
+    int (*write)(ssd1306_t *display, unsigned char *packet, int len);
+    void (*close)(ssd1306_t *display);
+} ssd1306_transport_t;
+
+extern const ssd1306_transport_t ssd1306_transport_i2c;
+extern const ssd1306_transport_t ssd1306_transport_virtual;
+
+/* Structure to hold SSD1306 display state */
+struct _ssd1306_t {
+    const ssd1306_transport_t *transport;  /* Bus backend, NULL for shared clients */
+    void *transport_data;    /* Backend state (virtual panel) */
     int i2c_fd;              /* I2C file descriptor */
     int i2c_addr;            /* I2C address */
     int width;               /* Display width */
     int height;              /* Display height */
     int pages;               /* Number of pages (height/8) */
     unsigned char *buffer;   /* Display buffer */
+    unsigned char *shadow;   /* Copy of the last frame sent to the panel */
+    int shadow_valid;        /* Shadow matches panel RAM */
     int buffer_size;         /* Buffer size in bytes */
     int vcc_state;           /* VCC state (external/internal) */
     int contrast;            /* Display contrast (0-255) */
-    int rotation;            /* Display rotation */
+    int rotation;            /* Drawing rotation, quarter turns clockwise */
+    int start_line;          /* RAM row shown first in the vertical scroll area */
+    int scroll_area_top;     /* Vertical scroll area: first panel row and */
+    int scroll_area_rows;    /*   number of rows, outside it rows are fixed */
+    int scroll_area_sent;    /* The area has been programmed since init */
+    int scroll_active;       /* Hardware scroll engine running */
+    unsigned char scroll_setup[SSD1306_SCROLL_SETUP];  /* Commands that restart it */
+    int scroll_setup_len;
+    int scroll_page0;        /* Pages of panel RAM the engine moves */
+    int scroll_page1;
+    int stale_page0;         /* Pages of panel RAM a stopped scroll left */
+    int stale_page1;         /*   out of step with the shadow (page1 < page0: none) */
     int cursor_x;            /* Text cursor X position */
     int cursor_y;            /* Text cursor Y position */
     int text_size;           /* Text size multiplier */
     int text_color;          /* Text color */
     int text_bg_color;       /* Text background color */
     int wrap;                /* Text wrapping enabled */
-} ssd1306_t;
+    int clip_x0;             /* Clip rectangle, inclusive; drawing outside */
+    int clip_y0;             /*   it is discarded (x1 < x0 when empty) */
+    int clip_x1;
+    int clip_y1;
+    int *dirty_x0;           /* Per-page first dirty column */
+    int *dirty_x1;           /* Per-page last dirty column (x1 < x0 means clean) */
+    unsigned long bytes_sent;       /* Total bytes written to the bus */
+    unsigned long flush_count;      /* Number of display updates */
+    unsigned long last_flush_bytes; /* Bytes written by the last update */
+    ssd1306_metrics_t metrics;      /* Latency and error counters */
+    unsigned long i2c_funcs; /* Adapter functionality mask (I2C_FUNCS) */
+    int xfer_mode;           /* Transfer strategy (SSD1306_XFER_*) */
+    int xfer_chunk;          /* Max payload bytes per transaction, 0 = unlimited */
+    double bus_bytes_per_sec;    /* Calibrated data throughput */
+    double bus_txn_latency_us;   /* Calibrated per-transaction latency */
+    pthread_mutex_t bus_lock;    /* Serializes bus access (recursive) */
+    pthread_mutex_t async_lock;  /* Guards the async_* state below */
+    pthread_cond_t async_cond;   /* Signals new frames, completion and shutdown */
+    pthread_t async_thread;      /* Background flush worker */
+    int async_running;           /* Worker thread has been started */
+    int async_stop;              /* Worker asked to drain and exit */
+    int async_pending;           /* A frame waits in async_frame */
+    int async_force;             /* Pending frame must be sent in full */
+    int async_busy;              /* Worker is transmitting async_front */
+    int async_error;             /* Last background flush failed */
+    unsigned char *async_frame;  /* Newest submitted frame */
+    unsigned char *async_front;  /* Frame being transmitted */
+    unsigned long frames_dropped;    /* Submitted frames replaced before transfer */
+    unsigned char async_cmds[SSD1306_ASYNC_COMMANDS];  /* Queued command bytes */
+    int async_cmds_len;          /* Bytes waiting in async_cmds */
+    int notify_fd[2];            /* Completion pipe, created on demand */
+    unsigned long notify_overflows;  /* Records lost to a full pipe */
+    int persistent;              /* Owned by the persistent list, outlives requests */
+    ssd1306_shm_t *shm;          /* Shared framebuffer, NULL for a private buffer */
+    size_t shm_size;             /* Mapped size of shm */
+    int shm_flusher;             /* This display sends the shared frames */
+    int shm_stop;                /* Flusher asked to exit (guarded by the shm lock) */
+    pthread_t shm_thread;        /* Flusher thread */
+    unsigned char *shm_private;  /* Own drawing buffer while flushing shared frames */
+    unsigned char *shm_snapshot; /* Copy of the shared frame being sent */
+    uint64_t shm_published;      /* Last sequence number published from here */
+};
+
+/* Panel sizes the framebuffer can hold: whole pages, whole bytes per row
+ * in the packed buffer formats, and columns that fit one 64-bit word in the
+ * bitmap, glyph and region move writers */
+static inline int ssd1306_size_supported(int64_t width, int64_t height)
+{
+    return width >= 8 && width <= SSD1306_LCDWIDTH_128 && width % 8 == 0 &&
+           height >= 8 && height <= SSD1306_LCDHEIGHT_64 && height % 8 == 0;
+}
+
+/* Drawing geometry: odd quarter turns swap the panel's axes */
+static inline int ssd1306_logical_width(const ssd1306_t *display)
+{
+    return (display->rotation & 1) ? display->height : display->width;
+}
+
+static inline int ssd1306_logical_height(const ssd1306_t *display)
+{
+    return (display->rotation & 1) ? display->width : display->height;
+}
+
+/* Display RAM row shown on panel row y. The start line rotates the rows of
+ * the vertical scroll area; rows above and below it stay in place. */
+static inline int ssd1306_ram_row(const ssd1306_t *display, int y)
+{
+    int top = display->scroll_area_top;
+
+    if (y < top || y >= top + display->scroll_area_rows) {
+        return y;
+    }
+    return top + (y - top + display->start_line) % display->scroll_area_rows;
+}
+
+/* SSD1306\Display object: one panel per instance */
+typedef struct {
+    ssd1306_t *display;      /* Open panel, NULL until begin() */
+    zend_object std;
+} php_ssd1306_object;
+
+static inline php_ssd1306_object *php_ssd1306_from_obj(zend_object *obj)
+{
+    return (php_ssd1306_object *) ((char *) obj - XtOffsetOf(php_ssd1306_object, std));
+}
+
+#define Z_SSD1306_P(zv) php_ssd1306_from_obj(Z_OBJ_P(zv))
+
+extern zend_class_entry *ssd1306_display_ce;
+
+/* Display slot a function works on: the object's own when called as a
+   method, otherwise the default display opened by ssd1306_begin() */
+ssd1306_t **php_ssd1306_slot(zval *object);
+#define PHP_SSD1306_DISPLAY() (*php_ssd1306_slot(getThis()))
 
 /* Function declarations */
 PHP_MINIT_FUNCTION(ssd1306);
 PHP_MSHUTDOWN_FUNCTION(ssd1306);
+PHP_RSHUTDOWN_FUNCTION(ssd1306);
 PHP_MINFO_FUNCTION(ssd1306);
 
 /* SSD1306 PHP Functions */
 PHP_FUNCTION(ssd1306_begin);
+PHP_FUNCTION(ssd1306_pbegin);
 PHP_FUNCTION(ssd1306_end);
 PHP_FUNCTION(ssd1306_display);
 PHP_FUNCTION(ssd1306_clear_display);
 PHP_FUNCTION(ssd1306_invert_display);
 PHP_FUNCTION(ssd1306_dim);
 PHP_FUNCTION(ssd1306_set_contrast);
+PHP_FUNCTION(ssd1306_set_rotation);
+PHP_FUNCTION(ssd1306_get_rotation);
+PHP_FUNCTION(ssd1306_set_start_line);
+PHP_FUNCTION(ssd1306_get_start_line);
+PHP_FUNCTION(ssd1306_scroll_vertical);
 PHP_FUNCTION(ssd1306_draw_pixel);
 PHP_FUNCTION(ssd1306_draw_line);
+PHP_FUNCTION(ssd1306_draw_fast_hline);
+PHP_FUNCTION(ssd1306_draw_fast_vline);
 PHP_FUNCTION(ssd1306_draw_rect);
 PHP_FUNCTION(ssd1306_fill_rect);
 PHP_FUNCTION(ssd1306_draw_circle);
 PHP_FUNCTION(ssd1306_fill_circle);
+PHP_FUNCTION(ssd1306_fill_round_rect);
+PHP_FUNCTION(ssd1306_draw_ellipse);
+PHP_FUNCTION(ssd1306_fill_ellipse);
 PHP_FUNCTION(ssd1306_draw_char);
 PHP_FUNCTION(ssd1306_print);
 PHP_FUNCTION(ssd1306_set_cursor);
@@ -137,26 +393,140 @@ PHP_FUNCTION(ssd1306_set_text_color);
 PHP_FUNCTION(ssd1306_get_width);
 PHP_FUNCTION(ssd1306_get_height);
 PHP_FUNCTION(ssd1306_get_pixel);
+PHP_FUNCTION(ssd1306_set_clip);
+PHP_FUNCTION(ssd1306_reset_clip);
+PHP_FUNCTION(ssd1306_get_clip);
+PHP_FUNCTION(ssd1306_get_buffer);
+PHP_FUNCTION(ssd1306_set_buffer);
+PHP_FUNCTION(ssd1306_draw_bitmap);
+PHP_FUNCTION(ssd1306_draw_batch);
+PHP_FUNCTION(ssd1306_copy_rect);
+PHP_FUNCTION(ssd1306_scroll_region);
 PHP_FUNCTION(ssd1306_start_scroll_right);
 PHP_FUNCTION(ssd1306_start_scroll_left);
 PHP_FUNCTION(ssd1306_start_scroll_diag_right);
 PHP_FUNCTION(ssd1306_start_scroll_diag_left);
+PHP_FUNCTION(ssd1306_start_scroll);
 PHP_FUNCTION(ssd1306_stop_scroll);
+PHP_FUNCTION(ssd1306_stats);
+PHP_FUNCTION(ssd1306_reset_stats);
+PHP_FUNCTION(ssd1306_commands);
+PHP_FUNCTION(ssd1306_set_transfer);
+PHP_FUNCTION(ssd1306_calibrate);
+PHP_FUNCTION(ssd1306_display_async);
+PHP_FUNCTION(ssd1306_wait);
+PHP_FUNCTION(ssd1306_is_busy);
+PHP_FUNCTION(ssd1306_commands_async);
+PHP_FUNCTION(ssd1306_completion_stream);
+PHP_FUNCTION(ssd1306_completions);
+PHP_FUNCTION(ssd1306_shared_begin);
+PHP_FUNCTION(ssd1306_shared_serve);
+PHP_FUNCTION(ssd1306_shared_remove);
+PHP_FUNCTION(ssd1306_virtual_ram);
+PHP_FUNCTION(ssd1306_virtual_log);
+PHP_FUNCTION(ssd1306_virtual_state);
+PHP_FUNCTION(ssd1306_virtual_fail);
+
+/* SSD1306\Display methods not shared with the procedural API */
+PHP_METHOD(SSD1306_Display, __construct);
+PHP_METHOD(SSD1306_Display, persistent);
 
 /* Internal C functions */
-int ssd1306_init(ssd1306_t *display, int i2c_bus, int i2c_addr, int width, int height, int vcc_state);
+int ssd1306_init(ssd1306_t *display, const ssd1306_transport_t *transport, int i2c_bus, int i2c_addr,
+                 int width, int height, int vcc_state);
+const ssd1306_transport_t *ssd1306_transport_get(int id);
+void ssd1306_init_state(ssd1306_t *display, int width, int height, int vcc_state);
 int ssd1306_init_sequence(ssd1306_t *display);
+int ssd1306_set_rotation_internal(ssd1306_t *display, int rotation);
+int ssd1306_set_start_line_internal(ssd1306_t *display, int line);
+int ssd1306_scroll_vertical_internal(ssd1306_t *display, int offset, int area_top, int area_rows);
+int ssd1306_scroll_frames_code(int frames);
+int ssd1306_start_scroll_internal(ssd1306_t *display, const ssd1306_scroll_t *scroll);
+int ssd1306_stop_scroll_internal(ssd1306_t *display);
 int ssd1306_command(ssd1306_t *display, unsigned char cmd);
+int ssd1306_commands(ssd1306_t *display, const unsigned char *cmds, int len);
 int ssd1306_data(ssd1306_t *display, unsigned char *data, int len);
+int ssd1306_probe_adapter(ssd1306_t *display);
+int ssd1306_set_transfer(ssd1306_t *display, int mode, int chunk);
+const char *ssd1306_xfer_mode_name(int mode);
+int ssd1306_calibrate(ssd1306_t *display, int rounds);
+uint64_t ssd1306_now_ns(void);
+void ssd1306_count_render(ssd1306_t *display, uint64_t start);
+double ssd1306_flush_percentile(ssd1306_t *display, double fraction);
+void ssd1306_reset_stats(ssd1306_t *display);
 void ssd1306_cleanup(ssd1306_t *display);
-int ssd1306_update_display(ssd1306_t *display);
-void ssd1306_set_pixel_internal(ssd1306_t *display, int x, int y, int color);
-int ssd1306_get_pixel_internal(ssd1306_t *display, int x, int y);
+int ssd1306_update_display(ssd1306_t *display, int force);
+int ssd1306_flush_frame(ssd1306_t *display, unsigned char *frame, int force);
+void ssd1306_mark_dirty(ssd1306_t *display, int x0, int y0, int x1, int y1);
+void ssd1306_mark_all_dirty(ssd1306_t *display);
+void ssd1306_set_pixel_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y, int color);
+int ssd1306_get_pixel_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y);
+void ssd1306_set_clip_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                               ssd1306_coord_t w, ssd1306_coord_t h);
+void ssd1306_reset_clip_internal(ssd1306_t *display);
+void ssd1306_draw_line_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                ssd1306_coord_t x1, ssd1306_coord_t y1, int color);
+void ssd1306_draw_fast_hline_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                      ssd1306_coord_t w, int color);
+void ssd1306_draw_fast_vline_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                      ssd1306_coord_t h, int color);
+void ssd1306_draw_rect_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                ssd1306_coord_t w, ssd1306_coord_t h, int color);
+void ssd1306_fill_rect_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                ssd1306_coord_t w, ssd1306_coord_t h, int color);
+void ssd1306_draw_circle_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                  ssd1306_coord_t r, int color);
+void ssd1306_fill_circle_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                  ssd1306_coord_t r, int color);
+void ssd1306_fill_round_rect_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                      ssd1306_coord_t w, ssd1306_coord_t h, ssd1306_coord_t r, int color);
+void ssd1306_draw_ellipse_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                   ssd1306_coord_t rx, ssd1306_coord_t ry, int color);
+void ssd1306_fill_ellipse_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                   ssd1306_coord_t rx, ssd1306_coord_t ry, int color);
+size_t ssd1306_bitmap_size(int format, int w, int h);
+size_t ssd1306_buffer_format_size(ssd1306_t *display, int format);
+void ssd1306_export_buffer(ssd1306_t *display, int format, unsigned char *out);
+int ssd1306_import_buffer(ssd1306_t *display, int format, const unsigned char *data, size_t len, size_t offset);
+void ssd1306_print_internal(ssd1306_t *display, const char *text, size_t text_len);
 void ssd1306_draw_char_internal(ssd1306_t *display, int x, int y, char c, int color, int bg, int size);
+void ssd1306_draw_bitmap_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                  const unsigned char *data, const unsigned char *mask,
+                                  int w, int h, int format, int color, int bg);
+void ssd1306_copy_rect_internal(ssd1306_t *display, ssd1306_coord_t sx, ssd1306_coord_t sy,
+                                ssd1306_coord_t w, ssd1306_coord_t h, ssd1306_coord_t dx, ssd1306_coord_t dy);
+void ssd1306_scroll_region_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                    ssd1306_coord_t w, ssd1306_coord_t h, ssd1306_coord_t dx, ssd1306_coord_t dy,
+                                    int fill);
+const char *ssd1306_draw_op_internal(ssd1306_t *display, const ssd1306_draw_op_t *op);
+size_t ssd1306_draw_packed_internal(ssd1306_t *display, const unsigned char *ops, size_t len,
+                                    ssd1306_draw_error_t error, void *ctx);
+
+/* Background flush worker (ssd1306_async.c) */
+void ssd1306_async_init(ssd1306_t *display);
+int ssd1306_async_submit(ssd1306_t *display, int force);
+int ssd1306_async_commands(ssd1306_t *display, const unsigned char *cmds, int len);
+int ssd1306_async_notify_fd(ssd1306_t *display);
+int ssd1306_async_completions(ssd1306_t *display, ssd1306_completion_t *records, int max);
+int ssd1306_async_wait(ssd1306_t *display);
+int ssd1306_async_busy(ssd1306_t *display);
+void ssd1306_async_stop(ssd1306_t *display);
+void ssd1306_async_destroy(ssd1306_t *display);
+
+/* Multi-process shared framebuffer (ssd1306_shared.c) */
+int ssd1306_shared_attach(ssd1306_t *display, const char *name, int width, int height);
+int ssd1306_shared_serve(ssd1306_t *display, const char *name);
+int ssd1306_shared_publish(ssd1306_t *display, int force);
+int ssd1306_shared_wait(ssd1306_t *display);
+int ssd1306_shared_busy(ssd1306_t *display);
+void ssd1306_shared_sequence(ssd1306_t *display, unsigned long *seq, unsigned long *flushed, int *flusher_pid);
+void ssd1306_shared_detach(ssd1306_t *display);
+int ssd1306_shared_remove(const char *name);
 
 /* Global display instance */
 ZEND_BEGIN_MODULE_GLOBALS(ssd1306)
     ssd1306_t *display;
+    zend_long num_persistent;
 ZEND_END_MODULE_GLOBALS(ssd1306)
 
 /* Declare the global variable */
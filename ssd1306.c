@@ -13,6 +13,8 @@
 #include "php.h"
 #include "php_ini.h"
 #include "ext/standard/info.h"
+#include "ext/spl/spl_exceptions.h"
+#include "zend_exceptions.h"
 #include "php_ssd1306.h"
 
 #include <fcntl.h>
@@ -21,6 +23,8 @@
 #include <linux/i2c-dev.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
 
 /* Global variables */
 ZEND_DECLARE_MODULE_GLOBALS(ssd1306)
@@ -36,8 +40,12 @@ zend_ssd1306_globals ssd1306_globals;
 static void php_ssd1306_init_globals(zend_ssd1306_globals *ssd1306_globals)
 {
     ssd1306_globals->display = NULL;
+    ssd1306_globals->num_persistent = 0;
 }
 
+/* Resource type of displays kept in the persistent list */
+static int le_ssd1306_persistent;
+
 /* Function argument info */
 ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_begin, 0, 0, 0)
     ZEND_ARG_INFO(0, i2c_bus)
@@ -45,11 +53,16 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_begin, 0, 0, 0)
     ZEND_ARG_INFO(0, width)
     ZEND_ARG_INFO(0, height)
     ZEND_ARG_INFO(0, vcc_state)
+    ZEND_ARG_INFO(0, transport)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_void, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_display, 0, 0, 0)
+    ZEND_ARG_INFO(0, force)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_bool, 0, 0, 1)
     ZEND_ARG_INFO(0, value)
 ZEND_END_ARG_INFO()
@@ -72,6 +85,20 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_line, 0, 0, 5)
     ZEND_ARG_INFO(0, color)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_fast_hline, 0, 0, 4)
+    ZEND_ARG_INFO(0, x)
+    ZEND_ARG_INFO(0, y)
+    ZEND_ARG_INFO(0, w)
+    ZEND_ARG_INFO(0, color)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_fast_vline, 0, 0, 4)
+    ZEND_ARG_INFO(0, x)
+    ZEND_ARG_INFO(0, y)
+    ZEND_ARG_INFO(0, h)
+    ZEND_ARG_INFO(0, color)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_rect, 0, 0, 5)
     ZEND_ARG_INFO(0, x)
     ZEND_ARG_INFO(0, y)
@@ -87,6 +114,23 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_circle, 0, 0, 4)
     ZEND_ARG_INFO(0, color)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_fill_round_rect, 0, 0, 6)
+    ZEND_ARG_INFO(0, x)
+    ZEND_ARG_INFO(0, y)
+    ZEND_ARG_INFO(0, w)
+    ZEND_ARG_INFO(0, h)
+    ZEND_ARG_INFO(0, r)
+    ZEND_ARG_INFO(0, color)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_ellipse, 0, 0, 5)
+    ZEND_ARG_INFO(0, x0)
+    ZEND_ARG_INFO(0, y0)
+    ZEND_ARG_INFO(0, rx)
+    ZEND_ARG_INFO(0, ry)
+    ZEND_ARG_INFO(0, color)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_print, 0, 0, 1)
     ZEND_ARG_INFO(0, text)
 ZEND_END_ARG_INFO()
@@ -101,6 +145,107 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_get_pixel, 0, 0, 2)
     ZEND_ARG_INFO(0, y)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_set_clip, 0, 0, 4)
+    ZEND_ARG_INFO(0, x)
+    ZEND_ARG_INFO(0, y)
+    ZEND_ARG_INFO(0, w)
+    ZEND_ARG_INFO(0, h)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_get_buffer, 0, 0, 0)
+    ZEND_ARG_INFO(0, format)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_set_buffer, 0, 0, 1)
+    ZEND_ARG_INFO(0, frame)
+    ZEND_ARG_INFO(0, offset)
+    ZEND_ARG_INFO(0, format)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_bitmap, 0, 0, 6)
+    ZEND_ARG_INFO(0, x)
+    ZEND_ARG_INFO(0, y)
+    ZEND_ARG_INFO(0, data)
+    ZEND_ARG_INFO(0, w)
+    ZEND_ARG_INFO(0, h)
+    ZEND_ARG_INFO(0, color)
+    ZEND_ARG_INFO(0, bg)
+    ZEND_ARG_INFO(0, format)
+    ZEND_ARG_INFO(0, mask)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_draw_batch, 0, 0, 1)
+    ZEND_ARG_INFO(0, ops)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_copy_rect, 0, 0, 6)
+    ZEND_ARG_INFO(0, sx)
+    ZEND_ARG_INFO(0, sy)
+    ZEND_ARG_INFO(0, w)
+    ZEND_ARG_INFO(0, h)
+    ZEND_ARG_INFO(0, dx)
+    ZEND_ARG_INFO(0, dy)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_scroll_region, 0, 0, 6)
+    ZEND_ARG_INFO(0, x)
+    ZEND_ARG_INFO(0, y)
+    ZEND_ARG_INFO(0, w)
+    ZEND_ARG_INFO(0, h)
+    ZEND_ARG_INFO(0, dx)
+    ZEND_ARG_INFO(0, dy)
+    ZEND_ARG_INFO(0, fill)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_commands, 0, 0, 1)
+    ZEND_ARG_ARRAY_INFO(0, bytes, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_set_transfer, 0, 0, 1)
+    ZEND_ARG_INFO(0, mode)
+    ZEND_ARG_INFO(0, chunk_size)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_calibrate, 0, 0, 0)
+    ZEND_ARG_INFO(0, rounds)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_shared_begin, 0, 0, 1)
+    ZEND_ARG_INFO(0, name)
+    ZEND_ARG_INFO(0, width)
+    ZEND_ARG_INFO(0, height)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_shared_name, 0, 0, 1)
+    ZEND_ARG_INFO(0, name)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_virtual_log, 0, 0, 0)
+    ZEND_ARG_INFO(0, clear)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_virtual_fail, 0, 0, 1)
+    ZEND_ARG_INFO(0, count)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_scroll_vertical, 0, 0, 1)
+    ZEND_ARG_INFO(0, offset)
+    ZEND_ARG_INFO(0, area_top)
+    ZEND_ARG_INFO(0, area_rows)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_start_scroll, 0, 0, 1)
+    ZEND_ARG_INFO(0, direction)
+    ZEND_ARG_INFO(0, start_page)
+    ZEND_ARG_INFO(0, end_page)
+    ZEND_ARG_INFO(0, frames)
+    ZEND_ARG_INFO(0, vertical_offset)
+    ZEND_ARG_INFO(0, area_top)
+    ZEND_ARG_INFO(0, area_rows)
+    ZEND_ARG_INFO(0, start_column)
+    ZEND_ARG_INFO(0, end_column)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_ssd1306_scroll, 0, 0, 2)
     ZEND_ARG_INFO(0, start)
     ZEND_ARG_INFO(0, stop)
@@ -109,18 +254,29 @@ ZEND_END_ARG_INFO()
 /* Function entries */
 const zend_function_entry ssd1306_functions[] = {
     PHP_FE(ssd1306_begin,                arginfo_ssd1306_begin)
+    PHP_FE(ssd1306_pbegin,               arginfo_ssd1306_begin)
     PHP_FE(ssd1306_end,                  arginfo_ssd1306_void)
-    PHP_FE(ssd1306_display,              arginfo_ssd1306_void)
+    PHP_FE(ssd1306_display,              arginfo_ssd1306_display)
     PHP_FE(ssd1306_clear_display,        arginfo_ssd1306_void)
     PHP_FE(ssd1306_invert_display,       arginfo_ssd1306_bool)
     PHP_FE(ssd1306_dim,                  arginfo_ssd1306_bool)
     PHP_FE(ssd1306_set_contrast,         arginfo_ssd1306_int)
+    PHP_FE(ssd1306_set_rotation,         arginfo_ssd1306_int)
+    PHP_FE(ssd1306_get_rotation,         arginfo_ssd1306_void)
+    PHP_FE(ssd1306_set_start_line,       arginfo_ssd1306_int)
+    PHP_FE(ssd1306_get_start_line,       arginfo_ssd1306_void)
+    PHP_FE(ssd1306_scroll_vertical,      arginfo_ssd1306_scroll_vertical)
     PHP_FE(ssd1306_draw_pixel,           arginfo_ssd1306_draw_pixel)
     PHP_FE(ssd1306_draw_line,            arginfo_ssd1306_draw_line)
+    PHP_FE(ssd1306_draw_fast_hline,      arginfo_ssd1306_draw_fast_hline)
+    PHP_FE(ssd1306_draw_fast_vline,      arginfo_ssd1306_draw_fast_vline)
     PHP_FE(ssd1306_draw_rect,            arginfo_ssd1306_draw_rect)
     PHP_FE(ssd1306_fill_rect,            arginfo_ssd1306_draw_rect)
     PHP_FE(ssd1306_draw_circle,          arginfo_ssd1306_draw_circle)
     PHP_FE(ssd1306_fill_circle,          arginfo_ssd1306_draw_circle)
+    PHP_FE(ssd1306_fill_round_rect,      arginfo_ssd1306_fill_round_rect)
+    PHP_FE(ssd1306_draw_ellipse,         arginfo_ssd1306_draw_ellipse)
+    PHP_FE(ssd1306_fill_ellipse,         arginfo_ssd1306_draw_ellipse)
     PHP_FE(ssd1306_print,                arginfo_ssd1306_print)
     PHP_FE(ssd1306_set_cursor,           arginfo_ssd1306_set_cursor)
     PHP_FE(ssd1306_set_text_size,        arginfo_ssd1306_int)
@@ -128,11 +284,112 @@ const zend_function_entry ssd1306_functions[] = {
     PHP_FE(ssd1306_get_width,            arginfo_ssd1306_void)
     PHP_FE(ssd1306_get_height,           arginfo_ssd1306_void)
     PHP_FE(ssd1306_get_pixel,            arginfo_ssd1306_get_pixel)
+    PHP_FE(ssd1306_set_clip,             arginfo_ssd1306_set_clip)
+    PHP_FE(ssd1306_reset_clip,           arginfo_ssd1306_void)
+    PHP_FE(ssd1306_get_clip,             arginfo_ssd1306_void)
+    PHP_FE(ssd1306_get_buffer,           arginfo_ssd1306_get_buffer)
+    PHP_FE(ssd1306_set_buffer,           arginfo_ssd1306_set_buffer)
+    PHP_FE(ssd1306_draw_bitmap,          arginfo_ssd1306_draw_bitmap)
+    PHP_FE(ssd1306_draw_batch,           arginfo_ssd1306_draw_batch)
+    PHP_FE(ssd1306_copy_rect,            arginfo_ssd1306_copy_rect)
+    PHP_FE(ssd1306_scroll_region,        arginfo_ssd1306_scroll_region)
     PHP_FE(ssd1306_start_scroll_right,   arginfo_ssd1306_scroll)
     PHP_FE(ssd1306_start_scroll_left,    arginfo_ssd1306_scroll)
     PHP_FE(ssd1306_start_scroll_diag_right, arginfo_ssd1306_scroll)
     PHP_FE(ssd1306_start_scroll_diag_left,  arginfo_ssd1306_scroll)
+    PHP_FE(ssd1306_start_scroll,         arginfo_ssd1306_start_scroll)
     PHP_FE(ssd1306_stop_scroll,          arginfo_ssd1306_void)
+    PHP_FE(ssd1306_stats,                arginfo_ssd1306_void)
+    PHP_FE(ssd1306_reset_stats,          arginfo_ssd1306_void)
+    PHP_FE(ssd1306_commands,             arginfo_ssd1306_commands)
+    PHP_FE(ssd1306_set_transfer,         arginfo_ssd1306_set_transfer)
+    PHP_FE(ssd1306_calibrate,            arginfo_ssd1306_calibrate)
+    PHP_FE(ssd1306_display_async,        arginfo_ssd1306_display)
+    PHP_FE(ssd1306_wait,                 arginfo_ssd1306_void)
+    PHP_FE(ssd1306_is_busy,              arginfo_ssd1306_void)
+    PHP_FE(ssd1306_commands_async,       arginfo_ssd1306_commands)
+    PHP_FE(ssd1306_completion_stream,    arginfo_ssd1306_void)
+    PHP_FE(ssd1306_completions,          arginfo_ssd1306_void)
+    PHP_FE(ssd1306_shared_begin,         arginfo_ssd1306_shared_begin)
+    PHP_FE(ssd1306_shared_serve,         arginfo_ssd1306_shared_name)
+    PHP_FE(ssd1306_shared_remove,        arginfo_ssd1306_shared_name)
+    PHP_FE(ssd1306_virtual_ram,          arginfo_ssd1306_void)
+    PHP_FE(ssd1306_virtual_log,          arginfo_ssd1306_virtual_log)
+    PHP_FE(ssd1306_virtual_state,        arginfo_ssd1306_void)
+    PHP_FE(ssd1306_virtual_fail,         arginfo_ssd1306_virtual_fail)
+    PHP_FE_END
+};
+
+/* SSD1306\Display methods share the function handlers, which act on $this */
+zend_class_entry *ssd1306_display_ce;
+static zend_object_handlers ssd1306_display_handlers;
+
+static const zend_function_entry ssd1306_display_methods[] = {
+    PHP_ME(SSD1306_Display, __construct, arginfo_ssd1306_begin, ZEND_ACC_PUBLIC)
+    PHP_ME(SSD1306_Display, persistent,  arginfo_ssd1306_begin, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME_MAPPING(begin,                ssd1306_begin,                arginfo_ssd1306_begin, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(pbegin,               ssd1306_pbegin,               arginfo_ssd1306_begin, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(end,                  ssd1306_end,                  arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(display,              ssd1306_display,              arginfo_ssd1306_display, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(clearDisplay,         ssd1306_clear_display,        arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(invertDisplay,        ssd1306_invert_display,       arginfo_ssd1306_bool, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(dim,                  ssd1306_dim,                  arginfo_ssd1306_bool, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setContrast,          ssd1306_set_contrast,         arginfo_ssd1306_int, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setRotation,          ssd1306_set_rotation,         arginfo_ssd1306_int, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getRotation,          ssd1306_get_rotation,         arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setStartLine,         ssd1306_set_start_line,       arginfo_ssd1306_int, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getStartLine,         ssd1306_get_start_line,       arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(scrollVertical,       ssd1306_scroll_vertical,      arginfo_ssd1306_scroll_vertical, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawPixel,            ssd1306_draw_pixel,           arginfo_ssd1306_draw_pixel, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawLine,             ssd1306_draw_line,            arginfo_ssd1306_draw_line, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawFastHLine,        ssd1306_draw_fast_hline,      arginfo_ssd1306_draw_fast_hline, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawFastVLine,        ssd1306_draw_fast_vline,      arginfo_ssd1306_draw_fast_vline, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawRect,             ssd1306_draw_rect,            arginfo_ssd1306_draw_rect, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(fillRect,             ssd1306_fill_rect,            arginfo_ssd1306_draw_rect, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawCircle,           ssd1306_draw_circle,          arginfo_ssd1306_draw_circle, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(fillCircle,           ssd1306_fill_circle,          arginfo_ssd1306_draw_circle, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(fillRoundRect,        ssd1306_fill_round_rect,      arginfo_ssd1306_fill_round_rect, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawEllipse,          ssd1306_draw_ellipse,         arginfo_ssd1306_draw_ellipse, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(fillEllipse,          ssd1306_fill_ellipse,         arginfo_ssd1306_draw_ellipse, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(print,                ssd1306_print,                arginfo_ssd1306_print, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setCursor,            ssd1306_set_cursor,           arginfo_ssd1306_set_cursor, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setTextSize,          ssd1306_set_text_size,        arginfo_ssd1306_int, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setTextColor,         ssd1306_set_text_color,       arginfo_ssd1306_int, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getWidth,             ssd1306_get_width,            arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getHeight,            ssd1306_get_height,           arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getPixel,             ssd1306_get_pixel,            arginfo_ssd1306_get_pixel, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setClip,              ssd1306_set_clip,             arginfo_ssd1306_set_clip, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(resetClip,            ssd1306_reset_clip,           arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getClip,              ssd1306_get_clip,             arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(getBuffer,            ssd1306_get_buffer,           arginfo_ssd1306_get_buffer, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setBuffer,            ssd1306_set_buffer,           arginfo_ssd1306_set_buffer, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawBitmap,           ssd1306_draw_bitmap,          arginfo_ssd1306_draw_bitmap, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(drawBatch,            ssd1306_draw_batch,           arginfo_ssd1306_draw_batch, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(copyRect,             ssd1306_copy_rect,            arginfo_ssd1306_copy_rect, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(scrollRegion,         ssd1306_scroll_region,        arginfo_ssd1306_scroll_region, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(startScrollRight,     ssd1306_start_scroll_right,   arginfo_ssd1306_scroll, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(startScrollLeft,      ssd1306_start_scroll_left,    arginfo_ssd1306_scroll, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(startScrollDiagRight, ssd1306_start_scroll_diag_right, arginfo_ssd1306_scroll, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(startScrollDiagLeft,  ssd1306_start_scroll_diag_left,  arginfo_ssd1306_scroll, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(startScroll,          ssd1306_start_scroll,         arginfo_ssd1306_start_scroll, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(stopScroll,           ssd1306_stop_scroll,          arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(stats,                ssd1306_stats,                arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(resetStats,           ssd1306_reset_stats,          arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(commands,             ssd1306_commands,             arginfo_ssd1306_commands, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(setTransfer,          ssd1306_set_transfer,         arginfo_ssd1306_set_transfer, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(calibrate,            ssd1306_calibrate,            arginfo_ssd1306_calibrate, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(displayAsync,         ssd1306_display_async,        arginfo_ssd1306_display, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(wait,                 ssd1306_wait,                 arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(isBusy,               ssd1306_is_busy,              arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(commandsAsync,        ssd1306_commands_async,       arginfo_ssd1306_commands, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(completionStream,     ssd1306_completion_stream,    arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(completions,          ssd1306_completions,          arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(sharedBegin,          ssd1306_shared_begin,         arginfo_ssd1306_shared_begin, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(sharedServe,          ssd1306_shared_serve,         arginfo_ssd1306_shared_name, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(virtualRam,           ssd1306_virtual_ram,          arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(virtualLog,           ssd1306_virtual_log,          arginfo_ssd1306_virtual_log, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(virtualState,         ssd1306_virtual_state,        arginfo_ssd1306_void, ZEND_ACC_PUBLIC)
+    PHP_ME_MAPPING(virtualFail,          ssd1306_virtual_fail,         arginfo_ssd1306_virtual_fail, ZEND_ACC_PUBLIC)
     PHP_FE_END
 };
 
@@ -144,7 +401,7 @@ zend_module_entry ssd1306_module_entry = {
     PHP_MINIT(ssd1306),
     PHP_MSHUTDOWN(ssd1306),
     NULL,
-    NULL,
+    PHP_RSHUTDOWN(ssd1306),
     PHP_MINFO(ssd1306),
     PHP_SSD1306_VERSION,
     STANDARD_MODULE_PROPERTIES
@@ -154,6 +411,147 @@ zend_module_entry ssd1306_module_entry = {
 ZEND_GET_MODULE(ssd1306)
 #endif
 
+/* Release the panel held in a display slot; persistent panels stay open */
+static void php_ssd1306_release(ssd1306_t **slot)
+{
+    if (*slot) {
+        if (!(*slot)->persistent) {
+            ssd1306_cleanup(*slot);
+            efree(*slot);
+        }
+        *slot = NULL;
+    }
+}
+
+/* Close a persistent panel when the process shuts down */
+static void php_ssd1306_persistent_dtor(zend_resource *rsrc)
+{
+    ssd1306_t *display = (ssd1306_t *) rsrc->ptr;
+
+    if (display) {
+        ssd1306_cleanup(display);
+        pefree(display, 1);
+        SSD1306_G(num_persistent)--;
+    }
+}
+
+/* Check a panel size given to one of the begin functions */
+static int php_ssd1306_check_size(zend_long width, zend_long height)
+{
+    if (!ssd1306_size_supported(width, height)) {
+        php_error_docref(NULL, E_WARNING, "Unsupported display size " ZEND_LONG_FMT "x" ZEND_LONG_FMT, width, height);
+        return -1;
+    }
+    return 0;
+}
+
+/* Open a panel into a display slot, replacing the one already there */
+static int php_ssd1306_open(ssd1306_t **slot, zend_long i2c_bus, zend_long i2c_addr,
+                            zend_long width, zend_long height, zend_long vcc_state, zend_long transport_id)
+{
+    const ssd1306_transport_t *transport = ssd1306_transport_get(transport_id);
+
+    if (!transport) {
+        php_error_docref(NULL, E_WARNING, "Unknown SSD1306 transport " ZEND_LONG_FMT, transport_id);
+        return -1;
+    }
+
+    if (php_ssd1306_check_size(width, height) != 0) {
+        return -1;
+    }
+
+    php_ssd1306_release(slot);
+
+    *slot = emalloc(sizeof(ssd1306_t));
+    memset(*slot, 0, sizeof(ssd1306_t));
+
+    if (ssd1306_init(*slot, transport, i2c_bus, i2c_addr, width, height, vcc_state) != 0) {
+        efree(*slot);
+        *slot = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Attach a display slot to the persistent panel for these settings, opening
+   it on first use; later requests reuse the controller and its framebuffer */
+static int php_ssd1306_popen(ssd1306_t **slot, zend_long i2c_bus, zend_long i2c_addr,
+                             zend_long width, zend_long height, zend_long vcc_state, zend_long transport_id)
+{
+    const ssd1306_transport_t *transport = ssd1306_transport_get(transport_id);
+    char key[96];
+    int key_len;
+    zval *le;
+    ssd1306_t *display;
+
+    if (!transport) {
+        php_error_docref(NULL, E_WARNING, "Unknown SSD1306 transport " ZEND_LONG_FMT, transport_id);
+        return -1;
+    }
+
+    if (php_ssd1306_check_size(width, height) != 0) {
+        return -1;
+    }
+
+    key_len = snprintf(key, sizeof(key), "ssd1306_%s_%ld_%ld_%ldx%ld_%ld", transport->name,
+                       (long) i2c_bus, (long) i2c_addr, (long) width, (long) height, (long) vcc_state);
+
+    php_ssd1306_release(slot);
+
+    le = zend_hash_str_find(&EG(persistent_list), key, key_len);
+    if (le && Z_RES_P(le)->type == le_ssd1306_persistent) {
+        *slot = (ssd1306_t *) Z_RES_P(le)->ptr;
+        /* A clip left by an earlier request would silently hide drawing */
+        ssd1306_reset_clip_internal(*slot);
+        return 0;
+    }
+
+    display = pemalloc(sizeof(ssd1306_t), 1);
+    memset(display, 0, sizeof(ssd1306_t));
+
+    if (ssd1306_init(display, transport, i2c_bus, i2c_addr, width, height, vcc_state) != 0) {
+        pefree(display, 1);
+        return -1;
+    }
+
+    display->persistent = 1;
+    zend_register_persistent_resource(key, key_len, display, le_ssd1306_persistent);
+    SSD1306_G(num_persistent)++;
+
+    *slot = display;
+    return 0;
+}
+
+ssd1306_t **php_ssd1306_slot(zval *object)
+{
+    if (object) {
+        return &Z_SSD1306_P(object)->display;
+    }
+    return &SSD1306_G(display);
+}
+
+static zend_object *php_ssd1306_create_object(zend_class_entry *ce)
+{
+    php_ssd1306_object *intern = zend_object_alloc(sizeof(php_ssd1306_object), ce);
+
+    intern->display = NULL;
+    zend_object_std_init(&intern->std, ce);
+    object_properties_init(&intern->std, ce);
+    intern->std.handlers = &ssd1306_display_handlers;
+
+    return &intern->std;
+}
+
+/* Panels are released as soon as the last reference goes away */
+static void php_ssd1306_free_object(zend_object *object)
+{
+    php_ssd1306_object *intern = php_ssd1306_from_obj(object);
+
+    php_ssd1306_release(&intern->display);
+    zend_object_std_dtor(&intern->std);
+}
+
 
 /* Module initialization */
 PHP_MINIT_FUNCTION(ssd1306)
@@ -177,33 +575,122 @@ PHP_MINIT_FUNCTION(ssd1306)
     REGISTER_LONG_CONSTANT("SSD1306_EXTERNALVCC", SSD1306_EXTERNALVCC, CONST_CS | CONST_PERSISTENT);
     REGISTER_LONG_CONSTANT("SSD1306_SWITCHCAPVCC", SSD1306_SWITCHCAPVCC, CONST_CS | CONST_PERSISTENT);
 
+    REGISTER_LONG_CONSTANT("SSD1306_XFER_WRITE", SSD1306_XFER_WRITE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_XFER_RDWR", SSD1306_XFER_RDWR, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_XFER_SMBUS", SSD1306_XFER_SMBUS, CONST_CS | CONST_PERSISTENT);
+
+    REGISTER_LONG_CONSTANT("SSD1306_TRANSPORT_I2C", SSD1306_TRANSPORT_I2C, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_TRANSPORT_VIRTUAL", SSD1306_TRANSPORT_VIRTUAL, CONST_CS | CONST_PERSISTENT);
+
+    REGISTER_LONG_CONSTANT("SSD1306_FORMAT_PAGE", SSD1306_FORMAT_PAGE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_FORMAT_ROW", SSD1306_FORMAT_ROW, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_FORMAT_XBM", SSD1306_FORMAT_XBM, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_FORMAT_BYTE", SSD1306_FORMAT_BYTE, CONST_CS | CONST_PERSISTENT);
+
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_PIXEL", SSD1306_DRAW_PIXEL, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_LINE", SSD1306_DRAW_LINE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_HLINE", SSD1306_DRAW_HLINE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_VLINE", SSD1306_DRAW_VLINE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_RECT", SSD1306_DRAW_RECT, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_FILL_RECT", SSD1306_DRAW_FILL_RECT, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_CIRCLE", SSD1306_DRAW_CIRCLE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_FILL_CIRCLE", SSD1306_DRAW_FILL_CIRCLE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_CHAR", SSD1306_DRAW_CHAR, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_TEXT", SSD1306_DRAW_TEXT, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_DRAW_BITMAP", SSD1306_DRAW_BITMAP, CONST_CS | CONST_PERSISTENT);
+
+    REGISTER_LONG_CONSTANT("SSD1306_SCROLL_RIGHT", SSD1306_SCROLL_RIGHT, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_SCROLL_LEFT", SSD1306_SCROLL_LEFT, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_SCROLL_DIAG_RIGHT", SSD1306_SCROLL_DIAG_RIGHT, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_SCROLL_DIAG_LEFT", SSD1306_SCROLL_DIAG_LEFT, CONST_CS | CONST_PERSISTENT);
+
+    REGISTER_LONG_CONSTANT("SSD1306_OP_DISPLAY", SSD1306_OP_DISPLAY, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("SSD1306_OP_COMMANDS", SSD1306_OP_COMMANDS, CONST_CS | CONST_PERSISTENT);
+
+    le_ssd1306_persistent = zend_register_list_destructors_ex(NULL, php_ssd1306_persistent_dtor,
+                                                              "SSD1306 persistent display", module_number);
+
+    /* Register SSD1306\Display */
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "SSD1306", "Display", ssd1306_display_methods);
+    ssd1306_display_ce = zend_register_internal_class(&ce);
+    ssd1306_display_ce->create_object = php_ssd1306_create_object;
+
+    memcpy(&ssd1306_display_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    ssd1306_display_handlers.offset = XtOffsetOf(php_ssd1306_object, std);
+    ssd1306_display_handlers.free_obj = php_ssd1306_free_object;
+    ssd1306_display_handlers.clone_obj = NULL;
+
     return SUCCESS;
 }
 
 /* Module shutdown */
 PHP_MSHUTDOWN_FUNCTION(ssd1306)
 {
-    if (SSD1306_G(display)) {
-        ssd1306_cleanup(SSD1306_G(display));
-        efree(SSD1306_G(display));
-        SSD1306_G(display) = NULL;
-    }
+    php_ssd1306_release(&SSD1306_G(display));
+    return SUCCESS;
+}
+
+/* Request shutdown: the display lives in request memory, so it (and its
+   background worker) must be released before that memory goes away */
+PHP_RSHUTDOWN_FUNCTION(ssd1306)
+{
+    php_ssd1306_release(&SSD1306_G(display));
     return SUCCESS;
 }
 
 /* Module info */
 PHP_MINFO_FUNCTION(ssd1306)
 {
+    char value[64];
+
     php_info_print_table_start();
     php_info_print_table_header(2, "SSD1306 OLED Display Support", "enabled");
     php_info_print_table_row(2, "Version", PHP_SSD1306_VERSION);
     php_info_print_table_row(2, "I2C Support", "enabled");
+
+    snprintf(value, sizeof(value), ZEND_LONG_FMT, SSD1306_G(num_persistent));
+    php_info_print_table_row(2, "Persistent displays", value);
+
+    if (SSD1306_G(display)) {
+        ssd1306_t *display = SSD1306_G(display);
+
+        if (display->transport) {
+            php_info_print_table_row(2, "Transport", display->transport->name);
+        }
+        php_info_print_table_row(2, "Transfer mode", ssd1306_xfer_mode_name(display->xfer_mode));
+        snprintf(value, sizeof(value), "%d", display->xfer_chunk);
+        php_info_print_table_row(2, "Transfer chunk size", display->xfer_chunk ? value : "unlimited");
+        if (display->bus_bytes_per_sec > 0) {
+            snprintf(value, sizeof(value), "%.0f bytes/s", display->bus_bytes_per_sec);
+            php_info_print_table_row(2, "Measured throughput", value);
+            snprintf(value, sizeof(value), "%.1f us", display->bus_txn_latency_us);
+            php_info_print_table_row(2, "Transaction latency", value);
+        }
+
+        snprintf(value, sizeof(value), "%lu (%lu bytes, %lu transactions)",
+                 display->flush_count, display->bytes_sent, display->metrics.transactions);
+        php_info_print_table_row(2, "Updates", value);
+        snprintf(value, sizeof(value), "%lu writes, %lu updates",
+                 display->metrics.write_errors, display->metrics.flush_errors);
+        php_info_print_table_row(2, "Failures", value);
+        if (display->flush_count) {
+            snprintf(value, sizeof(value), "p50 < %.0f us, p99 < %.0f us, max %.0f us",
+                     ssd1306_flush_percentile(display, 0.50), ssd1306_flush_percentile(display, 0.99),
+                     display->metrics.flush_max_ns / 1e3);
+            php_info_print_table_row(2, "Update latency", value);
+        }
+        snprintf(value, sizeof(value), "%.1f ms drawing, %.1f ms bus I/O",
+                 display->metrics.render_ns / 1e6, display->metrics.io_ns / 1e6);
+        php_info_print_table_row(2, "Time spent", value);
+    }
+
     php_info_print_table_end();
 }
 
 /* PHP Functions */
 
-/* {{{ proto bool ssd1306_begin([int i2c_bus, int i2c_addr, int width, int height, int vcc_state])
+/* {{{ proto bool ssd1306_begin([int i2c_bus, int i2c_addr, int width, int height, int vcc_state, int transport])
    Initialize SSD1306 display */
 PHP_FUNCTION(ssd1306_begin)
 {
@@ -212,25 +699,36 @@ PHP_FUNCTION(ssd1306_begin)
     zend_long width = SSD1306_LCDWIDTH_128;
     zend_long height = SSD1306_LCDHEIGHT_64;
     zend_long vcc_state = SSD1306_SWITCHCAPVCC;
+    zend_long transport = SSD1306_TRANSPORT_I2C;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|lllll", &i2c_bus, &i2c_addr, &width, &height, &vcc_state) == FAILURE) {
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|llllll", &i2c_bus, &i2c_addr, &width, &height, &vcc_state, &transport) == FAILURE) {
         RETURN_FALSE;
     }
 
-    /* Clean up existing display if any */
-    if (SSD1306_G(display)) {
-        ssd1306_cleanup(SSD1306_G(display));
-        efree(SSD1306_G(display));
+    if (php_ssd1306_open(php_ssd1306_slot(getThis()), i2c_bus, i2c_addr, width, height, vcc_state, transport) != 0) {
+        RETURN_FALSE;
     }
 
-    /* Allocate new display structure */
-    SSD1306_G(display) = emalloc(sizeof(ssd1306_t));
-    memset(SSD1306_G(display), 0, sizeof(ssd1306_t));
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_pbegin([int i2c_bus, int i2c_addr, int width, int height, int vcc_state, int transport])
+   Attach to a persistent display, initializing it only on first use */
+PHP_FUNCTION(ssd1306_pbegin)
+{
+    zend_long i2c_bus = 1;
+    zend_long i2c_addr = SSD1306_I2C_ADDRESS;
+    zend_long width = SSD1306_LCDWIDTH_128;
+    zend_long height = SSD1306_LCDHEIGHT_64;
+    zend_long vcc_state = SSD1306_SWITCHCAPVCC;
+    zend_long transport = SSD1306_TRANSPORT_I2C;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|llllll", &i2c_bus, &i2c_addr, &width, &height, &vcc_state, &transport) == FAILURE) {
+        RETURN_FALSE;
+    }
 
-    /* Initialize display */
-    if (ssd1306_init(SSD1306_G(display), i2c_bus, i2c_addr, width, height, vcc_state) != 0) {
-        efree(SSD1306_G(display));
-        SSD1306_G(display) = NULL;
+    if (php_ssd1306_popen(php_ssd1306_slot(getThis()), i2c_bus, i2c_addr, width, height, vcc_state, transport) != 0) {
         RETURN_FALSE;
     }
 
@@ -242,24 +740,75 @@ PHP_FUNCTION(ssd1306_begin)
    Cleanup SSD1306 display */
 PHP_FUNCTION(ssd1306_end)
 {
-    if (SSD1306_G(display)) {
-        ssd1306_cleanup(SSD1306_G(display));
-        efree(SSD1306_G(display));
-        SSD1306_G(display) = NULL;
+    php_ssd1306_release(php_ssd1306_slot(getThis()));
+}
+/* }}} */
+
+/* {{{ proto SSD1306\Display::__construct([int i2c_bus, int i2c_addr, int width, int height, int vcc_state, int transport])
+   Open a panel owned by this object; throws if it cannot be initialized */
+PHP_METHOD(SSD1306_Display, __construct)
+{
+    zend_long i2c_bus = 1;
+    zend_long i2c_addr = SSD1306_I2C_ADDRESS;
+    zend_long width = SSD1306_LCDWIDTH_128;
+    zend_long height = SSD1306_LCDHEIGHT_64;
+    zend_long vcc_state = SSD1306_SWITCHCAPVCC;
+    zend_long transport = SSD1306_TRANSPORT_I2C;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|llllll", &i2c_bus, &i2c_addr, &width, &height, &vcc_state, &transport) == FAILURE) {
+        return;
+    }
+
+    if (php_ssd1306_open(&Z_SSD1306_P(getThis())->display, i2c_bus, i2c_addr, width, height, vcc_state, transport) != 0) {
+        zend_throw_exception_ex(spl_ce_RuntimeException, 0,
+            "Failed to initialize SSD1306 display at 0x%02lX on I2C bus %ld", (long) i2c_addr, (long) i2c_bus);
     }
 }
 /* }}} */
 
-/* {{{ proto bool ssd1306_display()
-   Update display with buffer contents */
+/* {{{ proto SSD1306\Display SSD1306\Display::persistent([int i2c_bus, int i2c_addr, int width, int height, int vcc_state, int transport])
+   Get an instance attached to a persistent panel; throws if it cannot be initialized */
+PHP_METHOD(SSD1306_Display, persistent)
+{
+    zend_long i2c_bus = 1;
+    zend_long i2c_addr = SSD1306_I2C_ADDRESS;
+    zend_long width = SSD1306_LCDWIDTH_128;
+    zend_long height = SSD1306_LCDHEIGHT_64;
+    zend_long vcc_state = SSD1306_SWITCHCAPVCC;
+    zend_long transport = SSD1306_TRANSPORT_I2C;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|llllll", &i2c_bus, &i2c_addr, &width, &height, &vcc_state, &transport) == FAILURE) {
+        return;
+    }
+
+    object_init_ex(return_value, ssd1306_display_ce);
+
+    if (php_ssd1306_popen(&Z_SSD1306_P(return_value)->display, i2c_bus, i2c_addr, width, height, vcc_state, transport) != 0) {
+        zval_ptr_dtor(return_value);
+        ZVAL_NULL(return_value);
+        zend_throw_exception_ex(spl_ce_RuntimeException, 0,
+            "Failed to initialize SSD1306 display at 0x%02lX on I2C bus %ld", (long) i2c_addr, (long) i2c_bus);
+    }
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_display([bool force])
+   Update display with changed buffer contents, or all of it when forced */
 PHP_FUNCTION(ssd1306_display)
 {
-    if (!SSD1306_G(display)) {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_bool force = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|b", &force) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
 
-    if (ssd1306_update_display(SSD1306_G(display)) != 0) {
+    if (ssd1306_update_display(display, force) != 0) {
         RETURN_FALSE;
     }
 
@@ -271,12 +820,19 @@ PHP_FUNCTION(ssd1306_display)
    Clear display buffer */
 PHP_FUNCTION(ssd1306_clear_display)
 {
-    if (!SSD1306_G(display)) {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    memset(SSD1306_G(display)->buffer, 0, SSD1306_G(display)->buffer_size);
+    uint64_t start = ssd1306_now_ns();
+
+    memset(display->buffer, 0, display->buffer_size);
+    ssd1306_mark_all_dirty(display);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
@@ -284,19 +840,20 @@ PHP_FUNCTION(ssd1306_clear_display)
    Invert display colors */
 PHP_FUNCTION(ssd1306_invert_display)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_bool invert;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "b", &invert) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
 
     unsigned char cmd = invert ? SSD1306_INVERTDISPLAY : SSD1306_NORMALDISPLAY;
-    if (ssd1306_command(SSD1306_G(display), cmd) != 0) {
+    if (ssd1306_command(display, cmd) != 0) {
         RETURN_FALSE;
     }
 
@@ -308,20 +865,20 @@ PHP_FUNCTION(ssd1306_invert_display)
    Dim display */
 PHP_FUNCTION(ssd1306_dim)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_bool dim;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "b", &dim) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
 
-    unsigned char contrast = dim ? 0 : SSD1306_G(display)->contrast;
-    if (ssd1306_command(SSD1306_G(display), SSD1306_SETCONTRAST) != 0 ||
-        ssd1306_command(SSD1306_G(display), contrast) != 0) {
+    unsigned char cmds[] = { SSD1306_SETCONTRAST, dim ? 0 : display->contrast };
+    if (ssd1306_commands(display, cmds, sizeof(cmds)) != 0) {
         RETURN_FALSE;
     }
 
@@ -333,13 +890,14 @@ PHP_FUNCTION(ssd1306_dim)
    Set display contrast (0-255) */
 PHP_FUNCTION(ssd1306_set_contrast)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long contrast;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &contrast) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
@@ -349,10 +907,10 @@ PHP_FUNCTION(ssd1306_set_contrast)
         RETURN_FALSE;
     }
 
-    SSD1306_G(display)->contrast = contrast;
-    
-    if (ssd1306_command(SSD1306_G(display), SSD1306_SETCONTRAST) != 0 ||
-        ssd1306_command(SSD1306_G(display), contrast) != 0) {
+    display->contrast = contrast;
+
+    unsigned char cmds[] = { SSD1306_SETCONTRAST, contrast };
+    if (ssd1306_commands(display, cmds, sizeof(cmds)) != 0) {
         RETURN_FALSE;
     }
 
@@ -360,29 +918,28 @@ PHP_FUNCTION(ssd1306_set_contrast)
 }
 /* }}} */
 
-/* {{{ proto bool ssd1306_start_scroll_right(int start, int stop)
-   Start horizontal scroll right */
-PHP_FUNCTION(ssd1306_start_scroll_right)
+/* {{{ proto bool ssd1306_set_rotation(int rotation)
+   Rotate drawing by 0 to 3 quarter turns clockwise */
+PHP_FUNCTION(ssd1306_set_rotation)
 {
-    zend_long start, stop;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long rotation;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &rotation) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
 
-    if (ssd1306_command(SSD1306_G(display), SSD1306_RIGHT_HORIZONTAL_SCROLL) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||  /* Dummy byte */
-        ssd1306_command(SSD1306_G(display), start) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||  /* Time interval */
-        ssd1306_command(SSD1306_G(display), stop) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||  /* Dummy byte */
-        ssd1306_command(SSD1306_G(display), 0xFF) != 0 ||  /* Dummy byte */
-        ssd1306_command(SSD1306_G(display), SSD1306_ACTIVATE_SCROLL) != 0) {
+    if (rotation < 0 || rotation > 3) {
+        php_error_docref(NULL, E_WARNING, "Rotation must be between 0 and 3");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_set_rotation_internal(display, rotation) != 0) {
         RETURN_FALSE;
     }
 
@@ -390,61 +947,43 @@ PHP_FUNCTION(ssd1306_start_scroll_right)
 }
 /* }}} */
 
-/* {{{ proto bool ssd1306_start_scroll_left(int start, int stop)
-   Start horizontal scroll left */
-PHP_FUNCTION(ssd1306_start_scroll_left)
+/* {{{ proto int ssd1306_get_rotation()
+   Get the drawing rotation in quarter turns */
+PHP_FUNCTION(ssd1306_get_rotation)
 {
-    zend_long start, stop;
-
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
-        RETURN_FALSE;
-    }
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
-        RETURN_FALSE;
-    }
-
-    if (ssd1306_command(SSD1306_G(display), SSD1306_LEFT_HORIZONTAL_SCROLL) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||  /* Dummy byte */
-        ssd1306_command(SSD1306_G(display), start) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||  /* Time interval */
-        ssd1306_command(SSD1306_G(display), stop) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||  /* Dummy byte */
-        ssd1306_command(SSD1306_G(display), 0xFF) != 0 ||  /* Dummy byte */
-        ssd1306_command(SSD1306_G(display), SSD1306_ACTIVATE_SCROLL) != 0) {
-        RETURN_FALSE;
+        RETURN_LONG(0);
     }
 
-    RETURN_TRUE;
+    RETURN_LONG(display->rotation);
 }
 /* }}} */
 
-/* {{{ proto bool ssd1306_start_scroll_diag_right(int start, int stop)
-   Start diagonal scroll right */
-PHP_FUNCTION(ssd1306_start_scroll_diag_right)
+/* {{{ proto bool ssd1306_set_start_line(int line)
+   Move the visible window of the vertical scroll area to RAM row line */
+PHP_FUNCTION(ssd1306_set_start_line)
 {
-    zend_long start, stop;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long line;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &line) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
 
-    if (ssd1306_command(SSD1306_G(display), SSD1306_SET_VERTICAL_SCROLL_AREA) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||
-        ssd1306_command(SSD1306_G(display), SSD1306_G(display)->height) != 0 ||
-        ssd1306_command(SSD1306_G(display), SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||
-        ssd1306_command(SSD1306_G(display), start) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||
-        ssd1306_command(SSD1306_G(display), stop) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x01) != 0 ||
-        ssd1306_command(SSD1306_G(display), SSD1306_ACTIVATE_SCROLL) != 0) {
+    if (line < 0 || line >= display->scroll_area_rows) {
+        php_error_docref(NULL, E_WARNING, "Start line must be between 0 and %d", display->scroll_area_rows - 1);
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_set_start_line_internal(display, line) != 0) {
         RETURN_FALSE;
     }
 
@@ -452,31 +991,52 @@ PHP_FUNCTION(ssd1306_start_scroll_diag_right)
 }
 /* }}} */
 
-/* {{{ proto bool ssd1306_start_scroll_diag_left(int start, int stop)
-   Start diagonal scroll left */
-PHP_FUNCTION(ssd1306_start_scroll_diag_left)
+/* {{{ proto int ssd1306_get_start_line()
+   Get the start line of the vertical scroll area */
+PHP_FUNCTION(ssd1306_get_start_line)
 {
-    zend_long start, stop;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_LONG(0);
+    }
+
+    RETURN_LONG(display->start_line);
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_scroll_vertical(int offset [, int area_top [, int area_rows]])
+   Set the vertical scroll area and show it from RAM row offset on */
+PHP_FUNCTION(ssd1306_scroll_vertical)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long offset, area_top = 0, area_rows = -1;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l|ll", &offset, &area_top, &area_rows) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         RETURN_FALSE;
     }
 
-    if (ssd1306_command(SSD1306_G(display), SSD1306_SET_VERTICAL_SCROLL_AREA) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||
-        ssd1306_command(SSD1306_G(display), SSD1306_G(display)->height) != 0 ||
-        ssd1306_command(SSD1306_G(display), SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||
-        ssd1306_command(SSD1306_G(display), start) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x00) != 0 ||
-        ssd1306_command(SSD1306_G(display), stop) != 0 ||
-        ssd1306_command(SSD1306_G(display), 0x01) != 0 ||
-        ssd1306_command(SSD1306_G(display), SSD1306_ACTIVATE_SCROLL) != 0) {
+    if (area_rows < 0) {
+        area_rows = display->height - area_top;
+    }
+
+    if (area_top < 0 || area_top >= display->height || area_rows < 1 || area_rows > display->height - area_top) {
+        php_error_docref(NULL, E_WARNING, "Scroll area must lie within the display's %d rows", display->height);
+        RETURN_FALSE;
+    }
+
+    if (offset < 0 || offset >= area_rows) {
+        php_error_docref(NULL, E_WARNING, "Offset must be between 0 and " ZEND_LONG_FMT, area_rows - 1);
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_scroll_vertical_internal(display, offset, area_top, area_rows) != 0) {
         RETURN_FALSE;
     }
 
@@ -484,16 +1044,650 @@ PHP_FUNCTION(ssd1306_start_scroll_diag_left)
 }
 /* }}} */
 
-/* {{{ proto bool ssd1306_stop_scroll()
-   Stop scrolling */
-PHP_FUNCTION(ssd1306_stop_scroll)
+/* A scroll argument as an int: -1 picks the default, and other values
+   outside 0 .. INT_MAX become INT_MIN, which every range check rejects */
+static int php_ssd1306_int_arg(zend_long value, int fallback)
 {
-    if (!SSD1306_G(display)) {
-        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+    if (value == -1) {
+        return fallback;
+    }
+    return (value < 0 || value > INT_MAX) ? INT_MIN : (int) value;
+}
+
+/* Check scroll parameters (warning on the first bad one) and start the
+   scroll engine */
+static int php_ssd1306_scroll(ssd1306_t *display, const ssd1306_scroll_t *scroll)
+{
+    int diagonal = (scroll->direction == SSD1306_SCROLL_DIAG_RIGHT || scroll->direction == SSD1306_SCROLL_DIAG_LEFT);
+
+    if (scroll->direction < SSD1306_SCROLL_RIGHT || scroll->direction > SSD1306_SCROLL_DIAG_LEFT) {
+        php_error_docref(NULL, E_WARNING, "Unknown scroll direction");
+        return -1;
+    }
+    if (scroll->start_page < 0 || scroll->end_page >= display->pages || scroll->end_page < scroll->start_page) {
+        php_error_docref(NULL, E_WARNING, "Scroll pages must be an ascending range from 0 to %d", display->pages - 1);
+        return -1;
+    }
+    if (ssd1306_scroll_frames_code(scroll->frames) < 0) {
+        php_error_docref(NULL, E_WARNING, "Scroll interval must be 2, 3, 4, 5, 25, 64, 128 or 256 frames");
+        return -1;
+    }
+    if (diagonal) {
+        if (scroll->area_top < 0 || scroll->area_top >= display->height ||
+            scroll->area_rows < 1 || scroll->area_rows > display->height - scroll->area_top) {
+            php_error_docref(NULL, E_WARNING, "Scroll area must lie within the display's %d rows", display->height);
+            return -1;
+        }
+        if (scroll->vertical_offset < 0 || scroll->vertical_offset >= scroll->area_rows) {
+            php_error_docref(NULL, E_WARNING, "Vertical offset must be between 0 and %d", scroll->area_rows - 1);
+            return -1;
+        }
+        if (display->start_line >= scroll->area_rows) {
+            php_error_docref(NULL, E_WARNING, "Scroll area must hold the start line %d", display->start_line);
+            return -1;
+        }
+        if (scroll->start_column != -1) {
+            php_error_docref(NULL, E_WARNING, "Column ranges only apply to horizontal scrolls");
+            return -1;
+        }
+    } else if (scroll->start_column != -1 && (scroll->start_column < 0 ||
+               scroll->end_column >= display->width || scroll->end_column < scroll->start_column)) {
+        php_error_docref(NULL, E_WARNING, "Scroll columns must be an ascending range from 0 to %d", display->width - 1);
+        return -1;
+    }
+
+    return ssd1306_start_scroll_internal(display, scroll);
+}
+
+/* Start one of the fixed scrolls of the original API: every 5 frames, the
+   diagonal ones one row per step over the whole panel */
+static int php_ssd1306_scroll_pages(ssd1306_t *display, int direction, zend_long start, zend_long stop)
+{
+    ssd1306_scroll_t scroll = {
+        .direction = direction,
+        .start_page = php_ssd1306_int_arg(start, INT_MIN),
+        .end_page = php_ssd1306_int_arg(stop, INT_MIN),
+        .frames = 5,
+        .vertical_offset = 1,
+        .area_top = 0,
+        .area_rows = display->height,
+        .start_column = -1,
+        .end_column = -1,
+    };
+
+    return php_ssd1306_scroll(display, &scroll);
+}
+
+/* {{{ proto bool ssd1306_start_scroll(int direction [, int start_page [, int end_page [, int frames [, int vertical_offset [, int area_top [, int area_rows [, int start_column, int end_column]]]]]]])
+   Start the hardware scroll engine with all of its parameters */
+PHP_FUNCTION(ssd1306_start_scroll)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long direction, start_page = 0, end_page = -1, frames = 5, vertical_offset = 1;
+    zend_long area_top = -1, area_rows = -1, start_column = -1, end_column = -1;
+    ssd1306_scroll_t scroll;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l|llllllll", &direction, &start_page, &end_page, &frames,
+                              &vertical_offset, &area_top, &area_rows, &start_column, &end_column) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    scroll.direction = php_ssd1306_int_arg(direction, INT_MIN);
+    scroll.start_page = php_ssd1306_int_arg(start_page, 0);
+    scroll.end_page = php_ssd1306_int_arg(end_page, display->pages - 1);
+    scroll.frames = php_ssd1306_int_arg(frames, INT_MIN);
+    scroll.vertical_offset = php_ssd1306_int_arg(vertical_offset, INT_MIN);
+    scroll.area_top = php_ssd1306_int_arg(area_top, display->scroll_area_top);
+    scroll.area_rows = php_ssd1306_int_arg(area_rows, display->scroll_area_rows);
+    scroll.start_column = php_ssd1306_int_arg(start_column, -1);
+    scroll.end_column = php_ssd1306_int_arg(end_column, display->width - 1);
+
+    if (php_ssd1306_scroll(display, &scroll) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_start_scroll_right(int start, int stop)
+   Start horizontal scroll right */
+PHP_FUNCTION(ssd1306_start_scroll_right)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long start, stop;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (php_ssd1306_scroll_pages(display, SSD1306_SCROLL_RIGHT, start, stop) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_start_scroll_left(int start, int stop)
+   Start horizontal scroll left */
+PHP_FUNCTION(ssd1306_start_scroll_left)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long start, stop;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (php_ssd1306_scroll_pages(display, SSD1306_SCROLL_LEFT, start, stop) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_start_scroll_diag_right(int start, int stop)
+   Start diagonal scroll right */
+PHP_FUNCTION(ssd1306_start_scroll_diag_right)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long start, stop;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (php_ssd1306_scroll_pages(display, SSD1306_SCROLL_DIAG_RIGHT, start, stop) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_start_scroll_diag_left(int start, int stop)
+   Start diagonal scroll left */
+PHP_FUNCTION(ssd1306_start_scroll_diag_left)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long start, stop;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &start, &stop) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (php_ssd1306_scroll_pages(display, SSD1306_SCROLL_DIAG_LEFT, start, stop) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_stop_scroll()
+   Stop scrolling */
+PHP_FUNCTION(ssd1306_stop_scroll)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_stop_scroll_internal(display) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+
+/* {{{ proto array ssd1306_stats()
+   Get bus transfer counters */
+PHP_FUNCTION(ssd1306_stats)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zval histogram;
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+    add_assoc_string(return_value, "transport", display->transport ? (char *) display->transport->name : "shared");
+    add_assoc_long(return_value, "bytes_sent", display->bytes_sent);
+    add_assoc_long(return_value, "flushes", display->flush_count);
+    add_assoc_long(return_value, "last_flush_bytes", display->last_flush_bytes);
+    add_assoc_long(return_value, "transfer_mode", display->xfer_mode);
+    add_assoc_long(return_value, "transfer_chunk", display->xfer_chunk);
+    add_assoc_long(return_value, "i2c_funcs", display->i2c_funcs);
+    add_assoc_double(return_value, "bus_bytes_per_sec", display->bus_bytes_per_sec);
+    add_assoc_double(return_value, "bus_txn_latency_us", display->bus_txn_latency_us);
+    add_assoc_long(return_value, "frames_dropped", display->frames_dropped);
+    add_assoc_long(return_value, "completions_dropped", display->notify_overflows);
+
+    add_assoc_long(return_value, "transactions", display->metrics.transactions);
+    add_assoc_long(return_value, "write_errors", display->metrics.write_errors);
+    add_assoc_long(return_value, "flush_errors", display->metrics.flush_errors);
+    add_assoc_double(return_value, "io_time_us", display->metrics.io_ns / 1e3);
+    add_assoc_double(return_value, "flush_time_us", display->metrics.flush_ns / 1e3);
+    add_assoc_double(return_value, "flush_max_us", display->metrics.flush_max_ns / 1e3);
+    add_assoc_double(return_value, "flush_p50_us", ssd1306_flush_percentile(display, 0.50));
+    add_assoc_double(return_value, "flush_p99_us", ssd1306_flush_percentile(display, 0.99));
+    add_assoc_double(return_value, "render_time_us", display->metrics.render_ns / 1e3);
+    add_assoc_long(return_value, "render_calls", display->metrics.render_calls);
+
+    /* Update counts keyed by bucket upper bound in microseconds */
+    array_init(&histogram);
+    for (int bucket = 0; bucket < SSD1306_LATENCY_BUCKETS; bucket++) {
+        add_index_long(&histogram, 2L << bucket, display->metrics.flush_hist[bucket]);
+    }
+    add_assoc_zval(return_value, "flush_histogram", &histogram);
+
+    if (display->shm) {
+        unsigned long seq, flushed;
+        int flusher_pid;
+
+        ssd1306_shared_sequence(display, &seq, &flushed, &flusher_pid);
+        add_assoc_long(return_value, "shared_sequence", seq);
+        add_assoc_long(return_value, "shared_flushed", flushed);
+        add_assoc_long(return_value, "shared_flusher_pid", flusher_pid);
+    }
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_reset_stats()
+   Zero the transfer counters, latency histogram and render timing */
+PHP_FUNCTION(ssd1306_reset_stats)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    ssd1306_reset_stats(display);
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* Convert a PHP array of command bytes; returns the count or -1 (with a warning) */
+static int php_ssd1306_command_bytes(zval *bytes, unsigned char *cmds)
+{
+    zval *entry;
+    int len = 0;
+
+    if (zend_hash_num_elements(Z_ARRVAL_P(bytes)) > SSD1306_MAX_COMMANDS) {
+        php_error_docref(NULL, E_WARNING, "At most %d command bytes can be sent at once", SSD1306_MAX_COMMANDS);
+        return -1;
+    }
+
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(bytes), entry) {
+        zend_long value = zval_get_long(entry);
+        if (value < 0 || value > 255) {
+            php_error_docref(NULL, E_WARNING, "Command bytes must be between 0 and 255");
+            return -1;
+        }
+        cmds[len++] = (unsigned char) value;
+    } ZEND_HASH_FOREACH_END();
+
+    return len;
+}
+
+/* {{{ proto bool ssd1306_commands(array bytes)
+   Send a list of raw command bytes in a single bus transaction */
+PHP_FUNCTION(ssd1306_commands)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zval *bytes;
+    unsigned char cmds[SSD1306_MAX_COMMANDS];
+    int len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a", &bytes) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if ((len = php_ssd1306_command_bytes(bytes, cmds)) < 0) {
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_commands(display, cmds, len) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_set_transfer(int mode [, int chunk_size])
+   Override the transfer strategy chosen from the adapter capabilities */
+PHP_FUNCTION(ssd1306_set_transfer)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long mode, chunk = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l|l", &mode, &chunk) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (chunk < 0 || chunk > 4096) {
+        php_error_docref(NULL, E_WARNING, "Chunk size must be between 0 and 4096");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_set_transfer(display, mode, chunk) != 0) {
+        php_error_docref(NULL, E_WARNING, "Transfer mode not supported by this I2C adapter");
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto array ssd1306_calibrate([int rounds])
+   Measure bus throughput and per-transaction latency */
+PHP_FUNCTION(ssd1306_calibrate)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long rounds = 4;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|l", &rounds) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (rounds < 1 || rounds > 1000) {
+        php_error_docref(NULL, E_WARNING, "Rounds must be between 1 and 1000");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_calibrate(display, rounds) != 0) {
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+    add_assoc_long(return_value, "transfer_mode", display->xfer_mode);
+    add_assoc_long(return_value, "transfer_chunk", display->xfer_chunk);
+    add_assoc_double(return_value, "bus_bytes_per_sec", display->bus_bytes_per_sec);
+    add_assoc_double(return_value, "bus_txn_latency_us", display->bus_txn_latency_us);
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_display_async([bool force])
+   Hand the buffer to the background worker and return without waiting */
+PHP_FUNCTION(ssd1306_display_async)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_bool force = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|b", &force) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_async_submit(display, force) != 0) {
+        php_error_docref(NULL, E_WARNING, "Failed to start SSD1306 flush worker");
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_wait()
+   Wait for background updates to finish; false if the last one failed */
+PHP_FUNCTION(ssd1306_wait)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_async_wait(display) != 0) {
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_is_busy()
+   Check whether a background update is queued or in progress */
+PHP_FUNCTION(ssd1306_is_busy)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    RETURN_BOOL(ssd1306_async_busy(display));
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_commands_async(array bytes)
+   Queue command bytes for the background worker and return immediately */
+PHP_FUNCTION(ssd1306_commands_async)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zval *bytes;
+    unsigned char cmds[SSD1306_MAX_COMMANDS];
+    int len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a", &bytes) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if ((len = php_ssd1306_command_bytes(bytes, cmds)) < 0) {
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_async_commands(display, cmds, len) != 0) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 command queue is full");
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto resource ssd1306_completion_stream()
+   Get a stream that becomes readable when background operations finish */
+PHP_FUNCTION(ssd1306_completion_stream)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    php_stream *stream;
+    int fd;
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    fd = ssd1306_async_notify_fd(display);
+    if (fd < 0 || (fd = dup(fd)) < 0) {
+        php_error_docref(NULL, E_WARNING, "Failed to create SSD1306 completion pipe");
+        RETURN_FALSE;
+    }
+
+    stream = php_stream_fopen_from_fd(fd, "rb", NULL);
+    if (!stream) {
+        close(fd);
+        RETURN_FALSE;
+    }
+
+    php_stream_to_zval(stream, return_value);
+}
+/* }}} */
+
+/* {{{ proto array ssd1306_completions()
+   Collect finished background operations without blocking */
+PHP_FUNCTION(ssd1306_completions)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    ssd1306_completion_t records[64];
+    int count;
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+
+    while ((count = ssd1306_async_completions(display, records, 64)) > 0) {
+        for (int i = 0; i < count; i++) {
+            zval entry;
+
+            array_init(&entry);
+            add_assoc_long(&entry, "op", records[i].op);
+            add_assoc_bool(&entry, "ok", records[i].ok);
+            add_assoc_long(&entry, "bytes", records[i].bytes);
+            add_assoc_long(&entry, "errno", records[i].error);
+            if (records[i].ok) {
+                add_assoc_null(&entry, "error");
+            } else {
+                add_assoc_string(&entry, "error", strerror(records[i].error));
+            }
+            add_next_index_zval(return_value, &entry);
+        }
+    }
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_shared_begin(string name [, int width, int height])
+   Draw into a shared framebuffer that another process sends to the panel */
+PHP_FUNCTION(ssd1306_shared_begin)
+{
+    char *name;
+    size_t name_len;
+    zend_long width = SSD1306_LCDWIDTH_128;
+    zend_long height = SSD1306_LCDHEIGHT_64;
+    ssd1306_t **slot = php_ssd1306_slot(getThis());
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "s|ll", &name, &name_len, &width, &height) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (php_ssd1306_check_size(width, height) != 0) {
+        RETURN_FALSE;
+    }
+
+    php_ssd1306_release(slot);
+
+    *slot = emalloc(sizeof(ssd1306_t));
+    memset(*slot, 0, sizeof(ssd1306_t));
+
+    if (ssd1306_shared_attach(*slot, name, width, height) != 0) {
+        php_error_docref(NULL, E_WARNING, "Failed to attach shared display '%s': %s", name, strerror(errno));
+        efree(*slot);
+        *slot = NULL;
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_shared_serve(string name)
+   Become the only process sending a shared framebuffer to this panel */
+PHP_FUNCTION(ssd1306_shared_serve)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    char *name;
+    size_t name_len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "s", &name, &name_len) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (ssd1306_shared_serve(display, name) != 0) {
+        if (errno == EBUSY) {
+            php_error_docref(NULL, E_WARNING, "Shared display '%s' already has a flusher", name);
+        } else {
+            php_error_docref(NULL, E_WARNING, "Failed to serve shared display '%s': %s", name, strerror(errno));
+        }
+        RETURN_FALSE;
+    }
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_shared_remove(string name)
+   Remove a shared framebuffer name; attached processes keep working */
+PHP_FUNCTION(ssd1306_shared_remove)
+{
+    char *name;
+    size_t name_len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "s", &name, &name_len) == FAILURE) {
         RETURN_FALSE;
     }
 
-    if (ssd1306_command(SSD1306_G(display), SSD1306_DEACTIVATE_SCROLL) != 0) {
+    if (ssd1306_shared_remove(name) != 0) {
         RETURN_FALSE;
     }
 
@@ -0,0 +1,361 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP SSD1306 Extension - Background Flush Worker                     |
+  +----------------------------------------------------------------------+
+  | Copyright (c) Project Saturn Studios, LLC                           |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_ssd1306.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+/*
+ * Frames move through three buffers:
+ *   display->buffer      drawn into by PHP
+ *   display->async_frame newest submitted frame, overwritten by later submits
+ *   display->async_front frame the worker is putting on the bus
+ * Submitting copies the drawing buffer into async_frame; the worker swaps
+ * async_frame and async_front under the lock, so a frame submitted while a
+ * transfer is in flight replaces any older frame still waiting for it.
+ * Queued command batches are sent ahead of a waiting frame.
+ *
+ * When an event loop asked for it, every finished operation writes one
+ * ssd1306_completion_t to a non-blocking pipe, so completions and bus
+ * errors arrive on a descriptor that can be polled with other sockets.
+ * The worker never calls into PHP.
+ */
+
+/* Set up the bus lock and worker synchronization */
+void ssd1306_async_init(ssd1306_t *display)
+{
+    pthread_mutexattr_t attr;
+
+    /* Recursive so a flush can hold the lock across its window and data writes */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&display->bus_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_mutex_init(&display->async_lock, NULL);
+    pthread_cond_init(&display->async_cond, NULL);
+
+    display->async_running = 0;
+    display->async_stop = 0;
+    display->async_pending = 0;
+    display->async_force = 0;
+    display->async_busy = 0;
+    display->async_error = 0;
+    display->async_frame = NULL;
+    display->async_front = NULL;
+    display->async_cmds_len = 0;
+    display->notify_fd[0] = -1;
+    display->notify_fd[1] = -1;
+}
+
+/* Report a finished operation on the completion pipe (async_lock held) */
+static void ssd1306_async_notify(ssd1306_t *display, int op, int result, int error, unsigned long bytes)
+{
+    ssd1306_completion_t record;
+
+    if (display->notify_fd[1] < 0) {
+        return;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    record.ok = (result == 0);
+    record.error = (result == 0) ? 0 : error;
+    record.bytes = bytes;
+
+    /* Records are far below PIPE_BUF, so writes are atomic; a full pipe
+     * means nobody is reading, and the record is dropped */
+    if (write(display->notify_fd[1], &record, sizeof(record)) != sizeof(record)) {
+        display->notify_overflows++;
+    }
+}
+
+/* Worker thread: send the newest submitted frame until asked to stop.
+ * Pending frames are drained before exiting. */
+static void *ssd1306_async_worker(void *arg)
+{
+    ssd1306_t *display = arg;
+    unsigned char cmds[SSD1306_ASYNC_COMMANDS];
+
+    pthread_mutex_lock(&display->async_lock);
+
+    for (;;) {
+        while (!display->async_pending && !display->async_cmds_len && !display->async_stop) {
+            pthread_cond_wait(&display->async_cond, &display->async_lock);
+        }
+        if (!display->async_pending && !display->async_cmds_len) {
+            break;
+        }
+
+        int ncmds = display->async_cmds_len;
+        memcpy(cmds, display->async_cmds, ncmds);
+        display->async_cmds_len = 0;
+
+        unsigned char *frame = NULL;
+        int force = display->async_force;
+        if (display->async_pending) {
+            frame = display->async_frame;
+            display->async_frame = display->async_front;
+            display->async_front = frame;
+            display->async_pending = 0;
+            display->async_force = 0;
+        }
+        display->async_busy = 1;
+        pthread_mutex_unlock(&display->async_lock);
+
+        int cmd_result = 0, cmd_error = 0, frame_result = 0, frame_error = 0;
+        unsigned long cmd_bytes = 0, frame_bytes = 0, start;
+
+        /* Holding the bus lock keeps the byte counts to this worker's traffic */
+        pthread_mutex_lock(&display->bus_lock);
+        if (ncmds) {
+            start = display->bytes_sent;
+            cmd_result = ssd1306_commands(display, cmds, ncmds);
+            cmd_error = errno;
+            cmd_bytes = display->bytes_sent - start;
+        }
+        if (frame) {
+            start = display->bytes_sent;
+            frame_result = ssd1306_flush_frame(display, frame, force);
+            frame_error = errno;
+            frame_bytes = display->bytes_sent - start;
+
+            /* Submitting cleared the drawing bounds, so a later update
+             * would not know what failed to arrive; resend everything */
+            if (frame_result != 0) {
+                display->shadow_valid = 0;
+            }
+        }
+        pthread_mutex_unlock(&display->bus_lock);
+
+        pthread_mutex_lock(&display->async_lock);
+        if (ncmds) {
+            ssd1306_async_notify(display, SSD1306_OP_COMMANDS, cmd_result, cmd_error, cmd_bytes);
+        }
+        if (frame) {
+            ssd1306_async_notify(display, SSD1306_OP_DISPLAY, frame_result, frame_error, frame_bytes);
+        }
+        display->async_busy = 0;
+        display->async_error = (cmd_result != 0 || frame_result != 0);
+        pthread_cond_broadcast(&display->async_cond);
+    }
+
+    pthread_mutex_unlock(&display->async_lock);
+    return NULL;
+}
+
+/* Allocate the hand-off buffers and start the worker */
+static int ssd1306_async_start(ssd1306_t *display)
+{
+    int size = SSD1306_BUFFER_HEADROOM + display->buffer_size;
+
+    /* Both buffers keep headroom so the worker sends them without copying */
+    unsigned char *block = malloc(size * 2);
+    if (!block) {
+        return -1;
+    }
+    memset(block, 0, size * 2);
+    display->async_frame = block + SSD1306_BUFFER_HEADROOM;
+    display->async_front = block + size + SSD1306_BUFFER_HEADROOM;
+
+    display->async_stop = 0;
+    if (pthread_create(&display->async_thread, NULL, ssd1306_async_worker, display) != 0) {
+        free(block);
+        display->async_frame = NULL;
+        display->async_front = NULL;
+        return -1;
+    }
+
+    display->async_running = 1;
+    return 0;
+}
+
+/* Hand the current drawing buffer to the worker and return immediately */
+int ssd1306_async_submit(ssd1306_t *display, int force)
+{
+    /* Shared frames already have a flusher of their own */
+    if (display->shm) {
+        return ssd1306_shared_publish(display, force);
+    }
+
+    if (!display->async_running && ssd1306_async_start(display) != 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&display->async_lock);
+
+    if (display->async_pending) {
+        display->frames_dropped++;
+    }
+    memcpy(display->async_frame, display->buffer, display->buffer_size);
+    display->async_pending = 1;
+    display->async_force |= force;
+
+    pthread_cond_broadcast(&display->async_cond);
+    pthread_mutex_unlock(&display->async_lock);
+
+    /* The worker diffs whole frames, so the drawing bounds start afresh */
+    for (int page = 0; page < display->pages; page++) {
+        display->dirty_x0[page] = display->width;
+        display->dirty_x1[page] = -1;
+    }
+
+    return 0;
+}
+
+/* Queue command bytes for the worker and return immediately */
+int ssd1306_async_commands(ssd1306_t *display, const unsigned char *cmds, int len)
+{
+    int result = 0;
+
+    if (!display->async_running && ssd1306_async_start(display) != 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&display->async_lock);
+    if (display->async_cmds_len + len > SSD1306_ASYNC_COMMANDS) {
+        result = -1;
+    } else {
+        memcpy(display->async_cmds + display->async_cmds_len, cmds, len);
+        display->async_cmds_len += len;
+        pthread_cond_broadcast(&display->async_cond);
+    }
+    pthread_mutex_unlock(&display->async_lock);
+
+    return result;
+}
+
+/* Read end of the completion pipe, created on first use */
+int ssd1306_async_notify_fd(ssd1306_t *display)
+{
+    pthread_mutex_lock(&display->async_lock);
+    if (display->notify_fd[0] < 0) {
+        if (pipe(display->notify_fd) == 0) {
+            for (int i = 0; i < 2; i++) {
+                fcntl(display->notify_fd[i], F_SETFL, fcntl(display->notify_fd[i], F_GETFL) | O_NONBLOCK);
+                fcntl(display->notify_fd[i], F_SETFD, FD_CLOEXEC);
+            }
+        } else {
+            display->notify_fd[0] = -1;
+            display->notify_fd[1] = -1;
+        }
+    }
+    pthread_mutex_unlock(&display->async_lock);
+
+    return display->notify_fd[0];
+}
+
+/* Drain up to max completion records without blocking */
+int ssd1306_async_completions(ssd1306_t *display, ssd1306_completion_t *records, int max)
+{
+    ssize_t len;
+
+    if (display->notify_fd[0] < 0) {
+        return 0;
+    }
+
+    len = read(display->notify_fd[0], records, sizeof(*records) * max);
+    if (len < 0) {
+        return (errno == EAGAIN) ? 0 : -1;
+    }
+
+    return len / sizeof(*records);
+}
+
+/* Block until every queued frame and command has been sent.
+ * Returns -1 if the last background operation failed. */
+int ssd1306_async_wait(ssd1306_t *display)
+{
+    int result;
+
+    if (display->shm) {
+        return ssd1306_shared_wait(display);
+    }
+
+    if (!display->async_running) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&display->async_lock);
+    while (display->async_pending || display->async_cmds_len || display->async_busy) {
+        pthread_cond_wait(&display->async_cond, &display->async_lock);
+    }
+    result = display->async_error ? -1 : 0;
+    pthread_mutex_unlock(&display->async_lock);
+
+    return result;
+}
+
+/* Whether a frame is waiting for or undergoing transfer */
+int ssd1306_async_busy(ssd1306_t *display)
+{
+    int busy;
+
+    if (display->shm) {
+        return ssd1306_shared_busy(display);
+    }
+
+    if (!display->async_running) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&display->async_lock);
+    busy = display->async_pending || display->async_cmds_len || display->async_busy;
+    pthread_mutex_unlock(&display->async_lock);
+
+    return busy;
+}
+
+/* Let the worker send any pending frame, then join it */
+void ssd1306_async_stop(ssd1306_t *display)
+{
+    if (!display->async_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&display->async_lock);
+    display->async_stop = 1;
+    pthread_cond_broadcast(&display->async_cond);
+    pthread_mutex_unlock(&display->async_lock);
+
+    pthread_join(display->async_thread, NULL);
+    display->async_running = 0;
+
+    /* The two hand-off buffers share one allocation */
+    unsigned char *first = (display->async_frame < display->async_front) ? display->async_frame : display->async_front;
+    free(first - SSD1306_BUFFER_HEADROOM);
+    display->async_frame = NULL;
+    display->async_front = NULL;
+}
+
+/* Stop the worker and release synchronization objects */
+void ssd1306_async_destroy(ssd1306_t *display)
+{
+    ssd1306_async_stop(display);
+
+    if (display->notify_fd[0] >= 0) {
+        close(display->notify_fd[0]);
+        close(display->notify_fd[1]);
+        display->notify_fd[0] = -1;
+        display->notify_fd[1] = -1;
+    }
+
+    pthread_cond_destroy(&display->async_cond);
+    pthread_mutex_destroy(&display->async_lock);
+    pthread_mutex_destroy(&display->bus_lock);
+}
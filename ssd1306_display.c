@@ -16,57 +16,105 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
-/* Initialize SSD1306 display */
-int ssd1306_init(ssd1306_t *display, int i2c_bus, int i2c_addr, int width, int height, int vcc_state)
+/* Bus bytes a new address window costs: six command bytes, their control
+ * byte and the data control byte. Unchanged gaps shorter than this are
+ * cheaper to resend. */
+#define SSD1306_WINDOW_OVERHEAD 8
+
+/* Chunk size used when an adapter rejects a message as too long */
+#define SSD1306_FALLBACK_CHUNK 32
+
+/* Set geometry, contrast and text defaults */
+void ssd1306_init_state(ssd1306_t *display, int width, int height, int vcc_state)
 {
-    char i2c_device[32];
-    
-    /* Set display parameters */
     display->width = width;
     display->height = height;
     display->pages = height / 8;
     display->buffer_size = width * display->pages;
-    display->i2c_addr = i2c_addr;
     display->vcc_state = vcc_state;
     display->contrast = (vcc_state == SSD1306_EXTERNALVCC) ? 0x9F : 0xCF;
     display->rotation = 0;
+    display->start_line = 0;
+    display->scroll_area_top = 0;
+    display->scroll_area_rows = height;
+    display->scroll_area_sent = 0;
+    display->scroll_active = 0;
+    display->scroll_setup_len = 0;
+    display->stale_page0 = 0;
+    display->stale_page1 = -1;
     display->cursor_x = 0;
     display->cursor_y = 0;
     display->text_size = 1;
     display->text_color = SSD1306_WHITE;
     display->text_bg_color = SSD1306_BLACK;
     display->wrap = 1;
+    ssd1306_reset_clip_internal(display);
+}
 
-    /* Allocate display buffer */
-    display->buffer = malloc(display->buffer_size);
-    if (!display->buffer) {
+/* Initialize SSD1306 display */
+int ssd1306_init(ssd1306_t *display, const ssd1306_transport_t *transport, int i2c_bus, int i2c_addr,
+                 int width, int height, int vcc_state)
+{
+    if (!ssd1306_size_supported(width, height)) {
+        errno = EINVAL;
         return -1;
     }
-    memset(display->buffer, 0, display->buffer_size);
 
-    /* Open I2C device */
-    snprintf(i2c_device, sizeof(i2c_device), "/dev/i2c-%d", i2c_bus);
-    display->i2c_fd = open(i2c_device, O_RDWR);
-    if (display->i2c_fd < 0) {
-        free(display->buffer);
+    /* Set display parameters */
+    ssd1306_init_state(display, width, height, vcc_state);
+    display->i2c_addr = i2c_addr;
+
+    /* Allocate display buffer, preceded by room for the data control byte
+     * and followed by the shadow of panel RAM */
+    unsigned char *block = malloc(SSD1306_BUFFER_HEADROOM + display->buffer_size * 2);
+    if (!block) {
         return -1;
     }
+    memset(block, 0, SSD1306_BUFFER_HEADROOM + display->buffer_size * 2);
+    display->buffer = block + SSD1306_BUFFER_HEADROOM;
+    display->shadow = display->buffer + display->buffer_size;
+    display->shadow_valid = 0;
 
-    /* Set I2C slave address */
-    if (ioctl(display->i2c_fd, I2C_SLAVE, i2c_addr) < 0) {
-        close(display->i2c_fd);
-        free(display->buffer);
+    /* Allocate per-page dirty bounds (x0 and x1 share one block) */
+    display->dirty_x0 = malloc(sizeof(int) * display->pages * 2);
+    if (!display->dirty_x0) {
+        free(display->buffer - SSD1306_BUFFER_HEADROOM);
+        return -1;
+    }
+    display->dirty_x1 = display->dirty_x0 + display->pages;
+
+    /* Panel RAM content is unknown until the first (full) update */
+    ssd1306_mark_all_dirty(display);
+
+    /* Open the bus through the selected transport */
+    display->transport = transport;
+    display->transport_data = NULL;
+    if (transport->open(display, i2c_bus, i2c_addr) != 0) {
+        display->transport = NULL;
+        free(display->dirty_x0);
+        free(display->buffer - SSD1306_BUFFER_HEADROOM);
         return -1;
     }
 
+    /* Bus and background worker synchronization */
+    ssd1306_async_init(display);
+
     /* Initialize display with proper sequence */
     if (ssd1306_init_sequence(display) != 0) {
-        close(display->i2c_fd);
-        free(display->buffer);
+        ssd1306_async_destroy(display);
+        transport->close(display);
+        display->transport = NULL;
+        free(display->dirty_x0);
+        free(display->buffer - SSD1306_BUFFER_HEADROOM);
         return -1;
     }
 
@@ -76,138 +124,855 @@ int ssd1306_init(ssd1306_t *display, int i2c_bus, int i2c_addr, int width, int h
 /* Send initialization sequence to display */
 int ssd1306_init_sequence(ssd1306_t *display)
 {
-    /* Display off */
-    if (ssd1306_command(display, SSD1306_DISPLAYOFF) != 0) return -1;
+    int external = (display->vcc_state == SSD1306_EXTERNALVCC);
+    int flip = (display->rotation >= 2);
+    const unsigned char init[] = {
+        SSD1306_DISPLAYOFF,                              /* Display off */
+        SSD1306_SETDISPLAYCLOCKDIV, 0x80,                /* Default clock ratio */
+        SSD1306_SETMULTIPLEX, display->height - 1,       /* Multiplex ratio */
+        SSD1306_SETDISPLAYOFFSET, 0x00,                  /* No offset */
+        SSD1306_SETSTARTLINE | display->start_line,      /* Start line address */
+        SSD1306_CHARGEPUMP, external ? 0x10 : 0x14,      /* Charge pump */
+        SSD1306_MEMORYMODE, 0x00,                        /* Horizontal addressing mode */
+        SSD1306_SEGREMAP | (flip ? 0x0 : 0x1),           /* Segment re-map */
+        flip ? SSD1306_COMSCANINC : SSD1306_COMSCANDEC,  /* COM output scan direction */
+        SSD1306_SETCOMPINS,                              /* COM pins hardware configuration */
+            (display->height == 32 || display->height == 16) ? 0x02 : 0x12,
+        SSD1306_SETCONTRAST, display->contrast,          /* Contrast control */
+        SSD1306_SETPRECHARGE, external ? 0x22 : 0xF1,    /* Pre-charge period */
+        SSD1306_SETVCOMDETECT, 0x40,                     /* VCOMH deselect level */
+        SSD1306_DISPLAYALLON_RESUME,                     /* Resume to RAM content display */
+        SSD1306_NORMALDISPLAY,                           /* Normal display */
+        SSD1306_DEACTIVATE_SCROLL,                       /* Deactivate scroll */
+        SSD1306_DISPLAYON                                /* Display on */
+    };
+
+    return ssd1306_commands(display, init, sizeof(init));
+}
 
-    /* Set display clock divide ratio/oscillator frequency */
-    if (ssd1306_command(display, SSD1306_SETDISPLAYCLOCKDIV) != 0) return -1;
-    if (ssd1306_command(display, 0x80) != 0) return -1;  /* Default ratio */
+/* Set the drawing rotation in quarter turns clockwise. Half turns are done
+ * by the panel, which scans its segments and COM lines in reverse; odd
+ * quarter turns swap the axes of drawing coordinates in the rasterizer.
+ * Resets the clip rectangle to the new geometry. */
+int ssd1306_set_rotation_internal(ssd1306_t *display, int rotation)
+{
+    int flip = (rotation >= 2);
 
-    /* Set multiplex ratio */
-    if (ssd1306_command(display, SSD1306_SETMULTIPLEX) != 0) return -1;
-    if (ssd1306_command(display, display->height - 1) != 0) return -1;
+    if (flip != (display->rotation >= 2)) {
+        const unsigned char cmds[] = {
+            SSD1306_SEGREMAP | (flip ? 0x0 : 0x1),
+            flip ? SSD1306_COMSCANINC : SSD1306_COMSCANDEC,
+        };
 
-    /* Set display offset */
-    if (ssd1306_command(display, SSD1306_SETDISPLAYOFFSET) != 0) return -1;
-    if (ssd1306_command(display, 0x0) != 0) return -1;  /* No offset */
+        /* Shared framebuffer clients do not own the panel */
+        if (!display->transport || ssd1306_commands(display, cmds, sizeof(cmds)) != 0) {
+            return -1;
+        }
 
-    /* Set start line address */
-    if (ssd1306_command(display, SSD1306_SETSTARTLINE | 0x0) != 0) return -1;
+        /* The COM scan flips what is in RAM at once, the segment remap
+         * only what is written from now on, so all of RAM is rewritten */
+        pthread_mutex_lock(&display->bus_lock);
+        display->shadow_valid = 0;
+        pthread_mutex_unlock(&display->bus_lock);
+    }
 
-    /* Charge pump */
-    if (ssd1306_command(display, SSD1306_CHARGEPUMP) != 0) return -1;
-    if (display->vcc_state == SSD1306_EXTERNALVCC) {
-        if (ssd1306_command(display, 0x10) != 0) return -1;
+    display->rotation = rotation;
+    ssd1306_reset_clip_internal(display);
+    return 0;
+}
+
+/* Show display RAM from row line on at the top of the vertical scroll area:
+ * content moves up by line rows without any pixel data crossing the bus.
+ * Drawing follows the shift, so panel row y keeps meaning what is seen at
+ * row y. The controller wraps the start line over all 64 RAM rows until a
+ * scroll area is set, so shorter panels program theirs on first use. */
+int ssd1306_set_start_line_internal(ssd1306_t *display, int line)
+{
+    /* Shared framebuffer clients do not own the panel */
+    if (!display->transport) {
+        return -1;
+    }
+
+    if (!display->scroll_area_sent && display->height < 64) {
+        return ssd1306_scroll_vertical_internal(display, line, display->scroll_area_top,
+                                                display->scroll_area_rows);
+    }
+
+    if (ssd1306_command(display, SSD1306_SETSTARTLINE | line) != 0) {
+        return -1;
+    }
+
+    display->start_line = line;
+    return 0;
+}
+
+/* Set the vertical scroll area to area_rows panel rows from area_top, with
+ * the rows above and below it fixed, and its start line to offset, in one
+ * transaction */
+int ssd1306_scroll_vertical_internal(ssd1306_t *display, int offset, int area_top, int area_rows)
+{
+    const unsigned char cmds[] = {
+        SSD1306_SET_VERTICAL_SCROLL_AREA, area_top, area_rows,
+        SSD1306_SETSTARTLINE | offset,
+    };
+
+    if (!display->transport || ssd1306_commands(display, cmds, sizeof(cmds)) != 0) {
+        return -1;
+    }
+
+    display->scroll_area_top = area_top;
+    display->scroll_area_rows = area_rows;
+    display->scroll_area_sent = 1;
+    display->start_line = offset;
+    return 0;
+}
+
+/* Note that the scroll engine has stopped: panel RAM under the pages it
+ * moved no longer matches the shadow (bus lock held) */
+static void ssd1306_scroll_stopped(ssd1306_t *display)
+{
+    if (!display->scroll_active) {
+        return;
+    }
+
+    if (display->stale_page1 < display->stale_page0) {
+        display->stale_page0 = display->scroll_page0;
+        display->stale_page1 = display->scroll_page1;
     } else {
-        if (ssd1306_command(display, 0x14) != 0) return -1;
+        if (display->scroll_page0 < display->stale_page0) display->stale_page0 = display->scroll_page0;
+        if (display->scroll_page1 > display->stale_page1) display->stale_page1 = display->scroll_page1;
     }
+    display->scroll_active = 0;
+}
 
-    /* Memory mode */
-    if (ssd1306_command(display, SSD1306_MEMORYMODE) != 0) return -1;
-    if (ssd1306_command(display, 0x00) != 0) return -1;  /* Horizontal addressing mode */
+/* Frame interval codes of the scroll setup commands, by code */
+static const int ssd1306_scroll_frames[8] = { 5, 64, 128, 256, 3, 4, 25, 2 };
 
-    /* Set segment re-map */
-    if (ssd1306_command(display, SSD1306_SEGREMAP | 0x1) != 0) return -1;
+/* Interval code for a number of frames per scroll step, -1 if the engine
+ * has none */
+int ssd1306_scroll_frames_code(int frames)
+{
+    for (int code = 0; code < 8; code++) {
+        if (ssd1306_scroll_frames[code] == frames) {
+            return code;
+        }
+    }
+    return -1;
+}
 
-    /* Set COM output scan direction */
-    if (ssd1306_command(display, SSD1306_COMSCANDEC) != 0) return -1;
+/* Start the hardware scroll engine. The setup goes out as one transaction
+ * (deactivate, area, parameters, activate) and is kept, so updates can
+ * stop the engine while they rewrite panel RAM and start it again. The
+ * caller validates the parameters. */
+int ssd1306_start_scroll_internal(ssd1306_t *display, const ssd1306_scroll_t *scroll)
+{
+    unsigned char *cmd = display->scroll_setup;
+    int diagonal = (scroll->direction >= SSD1306_SCROLL_DIAG_RIGHT);
+    int result = -1;
+    int n = 0;
 
-    /* Set COM pins hardware configuration */
-    if (ssd1306_command(display, SSD1306_SETCOMPINS) != 0) return -1;
-    if (display->height == 32) {
-        if (ssd1306_command(display, 0x02) != 0) return -1;
-    } else if (display->height == 16) {
-        if (ssd1306_command(display, 0x02) != 0) return -1;
+    if (!display->transport) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&display->bus_lock);
+
+    cmd[n++] = SSD1306_DEACTIVATE_SCROLL;
+    if (diagonal) {
+        cmd[n++] = SSD1306_SET_VERTICAL_SCROLL_AREA;
+        cmd[n++] = scroll->area_top;
+        cmd[n++] = scroll->area_rows;
+        cmd[n++] = (scroll->direction == SSD1306_SCROLL_DIAG_RIGHT) ?
+            SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL : SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL;
+    } else {
+        cmd[n++] = (scroll->direction == SSD1306_SCROLL_RIGHT) ?
+            SSD1306_RIGHT_HORIZONTAL_SCROLL : SSD1306_LEFT_HORIZONTAL_SCROLL;
+    }
+    cmd[n++] = 0x00;                                  /* Dummy byte */
+    cmd[n++] = scroll->start_page;
+    cmd[n++] = ssd1306_scroll_frames_code(scroll->frames);
+    cmd[n++] = scroll->end_page;
+    if (diagonal) {
+        cmd[n++] = scroll->vertical_offset;
+    } else if (scroll->start_column < 0) {
+        cmd[n++] = 0x00;                              /* Dummy bytes */
+        cmd[n++] = 0xFF;
     } else {
-        if (ssd1306_command(display, 0x12) != 0) return -1;
+        cmd[n++] = scroll->start_column;
+        cmd[n++] = scroll->end_column;
     }
+    cmd[n++] = SSD1306_ACTIVATE_SCROLL;
+    display->scroll_setup_len = n;
+
+    /* A running engine leaves its pages moved, and so does this one */
+    ssd1306_scroll_stopped(display);
+
+    if (ssd1306_commands(display, cmd, n) == 0) {
+        display->scroll_active = 1;
+        if (diagonal) {
+            /* The vertical motion reaches every row, and the area is the
+             * one the start line scrolls */
+            display->scroll_page0 = 0;
+            display->scroll_page1 = display->pages - 1;
+            display->scroll_area_top = scroll->area_top;
+            display->scroll_area_rows = scroll->area_rows;
+            display->scroll_area_sent = 1;
+        } else {
+            display->scroll_page0 = scroll->start_page;
+            display->scroll_page1 = scroll->end_page;
+        }
+        result = 0;
+    }
+
+    pthread_mutex_unlock(&display->bus_lock);
+    return result;
+}
+
+/* Stop the hardware scroll engine. The pages it moved are rewritten by the
+ * next update. */
+int ssd1306_stop_scroll_internal(ssd1306_t *display)
+{
+    int result;
 
-    /* Set contrast control */
-    if (ssd1306_command(display, SSD1306_SETCONTRAST) != 0) return -1;
-    if (ssd1306_command(display, display->contrast) != 0) return -1;
+    pthread_mutex_lock(&display->bus_lock);
+    result = ssd1306_command(display, SSD1306_DEACTIVATE_SCROLL);
+    ssd1306_scroll_stopped(display);
+    pthread_mutex_unlock(&display->bus_lock);
 
-    /* Set pre-charge period */
-    if (ssd1306_command(display, SSD1306_SETPRECHARGE) != 0) return -1;
-    if (display->vcc_state == SSD1306_EXTERNALVCC) {
-        if (ssd1306_command(display, 0x22) != 0) return -1;
+    return result;
+}
+
+/* Query the adapter with I2C_FUNCS and choose how messages are sent:
+ * plain write() when it speaks I2C, otherwise SMBus I2C block writes */
+int ssd1306_probe_adapter(ssd1306_t *display)
+{
+    unsigned long funcs = 0;
+
+    if (ioctl(display->i2c_fd, I2C_FUNCS, &funcs) < 0) {
+        funcs = I2C_FUNC_I2C;  /* Old drivers without I2C_FUNCS speak plain I2C */
+    }
+    display->i2c_funcs = funcs;
+
+    if (funcs & I2C_FUNC_I2C) {
+        display->xfer_mode = SSD1306_XFER_WRITE;
+        display->xfer_chunk = 0;
+    } else if (funcs & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK) {
+        display->xfer_mode = SSD1306_XFER_SMBUS;
+        display->xfer_chunk = I2C_SMBUS_BLOCK_MAX;
     } else {
-        if (ssd1306_command(display, 0xF1) != 0) return -1;
+        return -1;
     }
 
-    /* Set VCOMH deselect level */
-    if (ssd1306_command(display, SSD1306_SETVCOMDETECT) != 0) return -1;
-    if (ssd1306_command(display, 0x40) != 0) return -1;
+    return 0;
+}
 
-    /* Entire display on (resume to RAM content display) */
-    if (ssd1306_command(display, SSD1306_DISPLAYALLON_RESUME) != 0) return -1;
+/* Select a transfer strategy explicitly. chunk is the largest payload per
+ * transaction, 0 for unlimited; SMBus is always capped at 32 bytes. */
+int ssd1306_set_transfer(ssd1306_t *display, int mode, int chunk)
+{
+    switch (mode) {
+        case SSD1306_XFER_WRITE:
+        case SSD1306_XFER_RDWR:
+            if (!(display->i2c_funcs & I2C_FUNC_I2C)) return -1;
+            break;
+        case SSD1306_XFER_SMBUS:
+            if (!(display->i2c_funcs & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK)) return -1;
+            if (chunk <= 0 || chunk > I2C_SMBUS_BLOCK_MAX) chunk = I2C_SMBUS_BLOCK_MAX;
+            break;
+        default:
+            return -1;
+    }
+
+    display->xfer_mode = mode;
+    display->xfer_chunk = chunk;
+    return 0;
+}
+
+/* Name of a transfer strategy for diagnostics */
+const char *ssd1306_xfer_mode_name(int mode)
+{
+    switch (mode) {
+        case SSD1306_XFER_WRITE: return "single message";
+        case SSD1306_XFER_RDWR:  return "I2C_RDWR chunks";
+        case SSD1306_XFER_SMBUS: return "SMBus block";
+    }
+    return "unknown";
+}
 
-    /* Set normal display */
-    if (ssd1306_command(display, SSD1306_NORMALDISPLAY) != 0) return -1;
+/* Open /dev/i2c-N, address the panel and pick a transfer strategy */
+static int ssd1306_i2c_open(ssd1306_t *display, int i2c_bus, int i2c_addr)
+{
+    char i2c_device[32];
 
-    /* Deactivate scroll */
-    if (ssd1306_command(display, SSD1306_DEACTIVATE_SCROLL) != 0) return -1;
+    snprintf(i2c_device, sizeof(i2c_device), "/dev/i2c-%d", i2c_bus);
+    display->i2c_fd = open(i2c_device, O_RDWR);
+    if (display->i2c_fd < 0) {
+        return -1;
+    }
 
-    /* Display on */
-    if (ssd1306_command(display, SSD1306_DISPLAYON) != 0) return -1;
+    /* Set I2C slave address, then pick a transfer strategy the adapter supports */
+    if (ioctl(display->i2c_fd, I2C_SLAVE, i2c_addr) < 0 || ssd1306_probe_adapter(display) != 0) {
+        close(display->i2c_fd);
+        display->i2c_fd = -1;
+        return -1;
+    }
 
     return 0;
 }
 
+static void ssd1306_i2c_close(ssd1306_t *display)
+{
+    close(display->i2c_fd);
+    display->i2c_fd = -1;
+}
+
+/* Put one complete message (control byte first) on the bus */
+static int ssd1306_i2c_write(ssd1306_t *display, unsigned char *packet, int len)
+{
+    switch (display->xfer_mode) {
+        case SSD1306_XFER_RDWR: {
+            struct i2c_msg msg;
+            struct i2c_rdwr_ioctl_data xfer;
+
+            msg.addr = display->i2c_addr;
+            msg.flags = 0;
+            msg.len = len;
+            msg.buf = packet;
+            xfer.msgs = &msg;
+            xfer.nmsgs = 1;
+
+            return (ioctl(display->i2c_fd, I2C_RDWR, &xfer) == 1) ? 0 : -1;
+        }
+        case SSD1306_XFER_SMBUS: {
+            union i2c_smbus_data data;
+            struct i2c_smbus_ioctl_data args;
+
+            /* The control byte travels as the SMBus command code */
+            data.block[0] = len - 1;
+            memcpy(&data.block[1], packet + 1, len - 1);
+            args.read_write = I2C_SMBUS_WRITE;
+            args.command = packet[0];
+            args.size = I2C_SMBUS_I2C_BLOCK_DATA;
+            args.data = &data;
+
+            return (ioctl(display->i2c_fd, I2C_SMBUS, &args) < 0) ? -1 : 0;
+        }
+        default:
+            return (write(display->i2c_fd, packet, len) == len) ? 0 : -1;
+    }
+}
+
+const ssd1306_transport_t ssd1306_transport_i2c = {
+    "i2c",
+    ssd1306_i2c_open,
+    ssd1306_i2c_write,
+    ssd1306_i2c_close
+};
+
+/* Transport for an SSD1306_TRANSPORT_* id, NULL if unknown */
+const ssd1306_transport_t *ssd1306_transport_get(int id)
+{
+    switch (id) {
+        case SSD1306_TRANSPORT_I2C:     return &ssd1306_transport_i2c;
+        case SSD1306_TRANSPORT_VIRTUAL: return &ssd1306_transport_virtual;
+    }
+    return NULL;
+}
+
+/* Send payload behind a control byte, split into transactions of at most
+ * xfer_chunk payload bytes. The byte before each chunk must be writable:
+ * it holds the control byte while that chunk is on the bus. */
+static int ssd1306_transfer(ssd1306_t *display, unsigned char control, unsigned char *payload, int len)
+{
+    int result = 0;
+
+    /* Shared framebuffer clients have no bus of their own */
+    if (!display->transport) {
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    pthread_mutex_lock(&display->bus_lock);
+
+    while (len > 0) {
+        int chunk = (display->xfer_chunk > 0 && len > display->xfer_chunk) ? display->xfer_chunk : len;
+        unsigned char *packet = payload - 1;
+        unsigned char saved = packet[0];
+
+        packet[0] = control;
+        uint64_t start = ssd1306_now_ns();
+        result = display->transport->write(display, packet, chunk + 1);
+        display->metrics.io_ns += ssd1306_now_ns() - start;
+        packet[0] = saved;
+
+        if (result != 0) {
+            display->metrics.write_errors++;
+
+            /* Adapters with a message length limit reject long messages
+             * before touching the bus, so retrying in chunks is safe */
+            if (errno == EOPNOTSUPP && display->xfer_mode == SSD1306_XFER_WRITE &&
+                chunk > SSD1306_FALLBACK_CHUNK) {
+                display->xfer_mode = SSD1306_XFER_RDWR;
+                display->xfer_chunk = SSD1306_FALLBACK_CHUNK;
+                continue;
+            }
+            result = -1;
+            break;
+        }
+
+        display->metrics.transactions++;
+        display->bytes_sent += chunk + 1;
+        payload += chunk;
+        len -= chunk;
+    }
+
+    pthread_mutex_unlock(&display->bus_lock);
+    return result;
+}
+
 /* Send command to display */
 int ssd1306_command(ssd1306_t *display, unsigned char cmd)
 {
-    unsigned char buffer[2];
-    buffer[0] = 0x00;  /* Command mode */
-    buffer[1] = cmd;
+    return ssd1306_commands(display, &cmd, 1);
+}
 
-    if (write(display->i2c_fd, buffer, 2) != 2) {
-        return -1;
+/* Send a list of command bytes, SSD1306_MAX_COMMANDS per transaction */
+int ssd1306_commands(ssd1306_t *display, const unsigned char *cmds, int len)
+{
+    unsigned char buffer[SSD1306_MAX_COMMANDS + 1];
+
+    while (len > 0) {
+        int chunk = (len > SSD1306_MAX_COMMANDS) ? SSD1306_MAX_COMMANDS : len;
+
+        memcpy(buffer + 1, cmds, chunk);
+        if (ssd1306_transfer(display, 0x00, buffer + 1, chunk) != 0) {  /* Command mode */
+            return -1;
+        }
+
+        cmds += chunk;
+        len -= chunk;
     }
 
     return 0;
 }
 
-/* Send data to display */
+/* Send data to display.
+ * The byte just before data must be writable (the display buffer keeps
+ * SSD1306_BUFFER_HEADROOM for this) so runs of the buffer go out without
+ * copying or allocating. */
 int ssd1306_data(ssd1306_t *display, unsigned char *data, int len)
 {
-    unsigned char *buffer = malloc(len + 1);
-    if (!buffer) {
-        return -1;
+    return ssd1306_transfer(display, 0x40, data, len);  /* Data mode */
+}
+
+/* Program the column/page address window for the next data transfer */
+static int ssd1306_set_window(ssd1306_t *display, int x0, int x1, int page0, int page1)
+{
+    const unsigned char window[] = {
+        SSD1306_COLUMNADDR, x0, x1,     /* Column start/end address */
+        SSD1306_PAGEADDR, page0, page1  /* Page start/end address */
+    };
+
+    return ssd1306_commands(display, window, sizeof(window));
+}
+
+/* Return the first column in [x, end) where buffer and shadow differ, or end.
+ * Compares a machine word at a time before falling back to single bytes. */
+static int ssd1306_diff_next(const unsigned char *buf, const unsigned char *shadow, int x, int end)
+{
+    while (x + (int)sizeof(uint64_t) <= end) {
+        uint64_t a, b;
+        memcpy(&a, buf + x, sizeof(a));
+        memcpy(&b, shadow + x, sizeof(b));
+        if (a != b) {
+            break;
+        }
+        x += sizeof(uint64_t);
+    }
+
+    while (x < end && buf[x] == shadow[x]) {
+        x++;
+    }
+
+    return x;
+}
+
+/* Send columns [x0, x1] of one page of frame and record them as present on the panel */
+static int ssd1306_send_run(ssd1306_t *display, unsigned char *frame, int page, int x0, int x1)
+{
+    int offset = page * display->width + x0;
+
+    if (ssd1306_set_window(display, x0, x1, page, page) != 0) return -1;
+    if (ssd1306_data(display, frame + offset, x1 - x0 + 1) != 0) return -1;
+
+    memcpy(display->shadow + offset, frame + offset, x1 - x0 + 1);
+    return 0;
+}
+
+/* Diff columns [x, end) of one page of frame against the shadow and send
+ * the differing runs. Runs separated by fewer unchanged bytes than a new
+ * window costs are merged. */
+static int ssd1306_send_page(ssd1306_t *display, unsigned char *frame, int page, int x, int end)
+{
+    const unsigned char *buf = frame + page * display->width;
+    const unsigned char *shadow = display->shadow + page * display->width;
+
+    while ((x = ssd1306_diff_next(buf, shadow, x, end)) < end) {
+        int run_start = x;
+        int run_end;
+
+        for (;;) {
+            while (x < end && buf[x] != shadow[x]) {
+                x++;
+            }
+            run_end = x - 1;
+
+            /* Absorb the following run if the gap is cheaper than a new window */
+            int next = ssd1306_diff_next(buf, shadow, x, end);
+            if (next < end && next - x <= SSD1306_WINDOW_OVERHEAD) {
+                x = next;
+                continue;
+            }
+            break;
+        }
+
+        if (ssd1306_send_run(display, frame, page, run_start, run_end) != 0) return -1;
+        x = run_end + 1;
+    }
+
+    return 0;
+}
+
+/* Send pages page0..page1 of frame whole and record them as present on the
+ * panel */
+static int ssd1306_send_pages(ssd1306_t *display, unsigned char *frame, int page0, int page1)
+{
+    int offset = page0 * display->width;
+    int len = (page1 - page0 + 1) * display->width;
+
+    if (ssd1306_set_window(display, 0, display->width - 1, page0, page1) != 0) return -1;
+    if (ssd1306_data(display, frame + offset, len) != 0) return -1;
+
+    memcpy(display->shadow + offset, frame + offset, len);
+    return 0;
+}
+
+/* Whether an update of frame would write panel RAM. Only asked while the
+ * scroll engine runs, so unchanged frames leave it running. */
+static int ssd1306_frame_changed(ssd1306_t *display, unsigned char *frame, int force,
+                                 int *dirty_x0, int *dirty_x1)
+{
+    if (force || !display->shadow_valid || display->stale_page1 >= display->stale_page0) {
+        return 1;
+    }
+
+    for (int page = 0; page < display->pages; page++) {
+        int x0 = dirty_x0 ? dirty_x0[page] : 0;
+        int x1 = dirty_x1 ? dirty_x1[page] : display->width - 1;
+        int offset = page * display->width;
+
+        if (x0 <= x1 && ssd1306_diff_next(frame + offset, display->shadow + offset, x0, x1 + 1) <= x1) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Monotonic clock in nanoseconds, for the instrumentation counters */
+uint64_t ssd1306_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* Charge a drawing call that began at start to the render counters */
+void ssd1306_count_render(ssd1306_t *display, uint64_t start)
+{
+    display->metrics.render_ns += ssd1306_now_ns() - start;
+    display->metrics.render_calls++;
+}
+
+/* Add an update's duration to the latency histogram (bus lock held) */
+static void ssd1306_count_flush(ssd1306_t *display, uint64_t elapsed_ns)
+{
+    uint64_t us = elapsed_ns / 1000;
+    int bucket = 0;
+
+    while (us > 1 && bucket < SSD1306_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+
+    display->metrics.flush_hist[bucket]++;
+    display->metrics.flush_ns += elapsed_ns;
+    if (elapsed_ns > display->metrics.flush_max_ns) {
+        display->metrics.flush_max_ns = elapsed_ns;
+    }
+}
+
+/* Update latency below which the given fraction of updates fell, in
+ * microseconds. Resolution is the histogram bucket: the result is the
+ * upper bound of the bucket holding that update, capped at the slowest
+ * update seen. */
+double ssd1306_flush_percentile(ssd1306_t *display, double fraction)
+{
+    double max_us = display->metrics.flush_max_ns / 1e3;
+    unsigned long total = 0, seen = 0;
+
+    for (int bucket = 0; bucket < SSD1306_LATENCY_BUCKETS; bucket++) {
+        total += display->metrics.flush_hist[bucket];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    for (int bucket = 0; bucket < SSD1306_LATENCY_BUCKETS - 1; bucket++) {
+        seen += display->metrics.flush_hist[bucket];
+        if (seen >= fraction * total) {
+            double bound = (double) (2UL << bucket);
+            return (bound < max_us) ? bound : max_us;
+        }
+    }
+
+    /* Slower than the histogram reaches */
+    return max_us;
+}
+
+/* Zero the transfer counters and instrumentation; calibration results stay */
+void ssd1306_reset_stats(ssd1306_t *display)
+{
+    pthread_mutex_lock(&display->bus_lock);
+    display->bytes_sent = 0;
+    display->flush_count = 0;
+    display->last_flush_bytes = 0;
+    memset(&display->metrics, 0, sizeof(display->metrics));
+    pthread_mutex_unlock(&display->bus_lock);
+
+    pthread_mutex_lock(&display->async_lock);
+    display->frames_dropped = 0;
+    display->notify_overflows = 0;
+    pthread_mutex_unlock(&display->async_lock);
+}
+
+/* Send frame to the panel.
+ * With dirty bounds, only those columns of each page are diffed against
+ * the shadow of the last frame sent (and the bounds are reset once the
+ * page is on the panel); without them every page is diffed in full. A
+ * forced update, or one with no valid shadow, resends the whole frame.
+ * Pages a stopped scroll moved are resent whole. A running scroll is
+ * stopped while RAM is written and restarted afterwards, as the panel
+ * requires; frames without changes leave it running. */
+static int ssd1306_flush(ssd1306_t *display, unsigned char *frame, int force, int *dirty_x0, int *dirty_x1)
+{
+    unsigned long start_bytes = display->bytes_sent;
+    int result = 0;
+    int restart = 0;
+
+    /* Window programming and data must not interleave with another flush */
+    pthread_mutex_lock(&display->bus_lock);
+
+    uint64_t start = ssd1306_now_ns();
+
+    if (display->scroll_active && ssd1306_frame_changed(display, frame, force, dirty_x0, dirty_x1)) {
+        if (ssd1306_command(display, SSD1306_DEACTIVATE_SCROLL) != 0) {
+            result = -1;
+        } else {
+            ssd1306_scroll_stopped(display);
+            restart = 1;
+        }
     }
 
-    buffer[0] = 0x40;  /* Data mode */
-    memcpy(buffer + 1, data, len);
+    if (result != 0) {
+        /* The scroll is still running; leave RAM alone */
+    } else if (force || !display->shadow_valid) {
+        if (ssd1306_set_window(display, 0, display->width - 1, 0, display->pages - 1) != 0 ||
+            ssd1306_data(display, frame, display->buffer_size) != 0) {
+            result = -1;
+        } else {
+            memcpy(display->shadow, frame, display->buffer_size);
+            display->shadow_valid = 1;
+            display->stale_page0 = 0;
+            display->stale_page1 = -1;
+        }
+    } else {
+        if (display->stale_page1 >= display->stale_page0) {
+            result = ssd1306_send_pages(display, frame, display->stale_page0, display->stale_page1);
+            if (result == 0) {
+                display->stale_page0 = 0;
+                display->stale_page1 = -1;
+            }
+        }
+
+        for (int page = 0; page < display->pages && result == 0; page++) {
+            if (dirty_x0) {
+                result = ssd1306_send_page(display, frame, page, dirty_x0[page], dirty_x1[page] + 1);
+            } else {
+                result = ssd1306_send_page(display, frame, page, 0, display->width);
+            }
+        }
+    }
+
+    if (restart && result == 0) {
+        if (ssd1306_commands(display, display->scroll_setup, display->scroll_setup_len) != 0) {
+            result = -1;
+        } else {
+            display->scroll_active = 1;
+        }
+    }
+
+    if (result == 0) {
+        /* On failure the bounds stay; pages already sent match the shadow
+         * and will not be resent */
+        if (dirty_x0) {
+            for (int page = 0; page < display->pages; page++) {
+                dirty_x0[page] = display->width;
+                dirty_x1[page] = -1;
+            }
+        }
+
+        display->flush_count++;
+        display->last_flush_bytes = display->bytes_sent - start_bytes;
+    } else {
+        display->metrics.flush_errors++;
+    }
 
-    int result = (write(display->i2c_fd, buffer, len + 1) == (len + 1)) ? 0 : -1;
-    free(buffer);
+    ssd1306_count_flush(display, ssd1306_now_ns() - start);
 
+    pthread_mutex_unlock(&display->bus_lock);
     return result;
 }
 
-/* Update display with buffer contents */
-int ssd1306_update_display(ssd1306_t *display)
+/* Update display with buffer contents, sending only what changed since the
+ * last frame reached the panel */
+int ssd1306_update_display(ssd1306_t *display, int force)
 {
-    /* Set column address range */
-    if (ssd1306_command(display, SSD1306_COLUMNADDR) != 0) return -1;
-    if (ssd1306_command(display, 0) != 0) return -1;  /* Column start address */
-    if (ssd1306_command(display, display->width - 1) != 0) return -1;  /* Column end address */
+    /* Shared frames are sent by the flusher */
+    if (display->shm) {
+        return ssd1306_shared_publish(display, force);
+    }
+
+    /* Frames already handed to the background worker go out first */
+    if (display->async_running) {
+        ssd1306_async_wait(display);
+    }
 
-    /* Set page address range */
-    if (ssd1306_command(display, SSD1306_PAGEADDR) != 0) return -1;
-    if (ssd1306_command(display, 0) != 0) return -1;  /* Page start address */
-    if (ssd1306_command(display, display->pages - 1) != 0) return -1;  /* Page end address */
+    return ssd1306_flush(display, display->buffer, force, display->dirty_x0, display->dirty_x1);
+}
 
-    /* Send buffer data */
-    return ssd1306_data(display, display->buffer, display->buffer_size);
+/* Send a complete frame to the panel (used by the background worker) */
+int ssd1306_flush_frame(ssd1306_t *display, unsigned char *frame, int force)
+{
+    return ssd1306_flush(display, frame, force, NULL, NULL);
 }
 
-/* Set pixel in buffer */
-void ssd1306_set_pixel_internal(ssd1306_t *display, int x, int y, int color)
+/* Microseconds elapsed since start on the monotonic clock */
+static double ssd1306_elapsed_us(const struct timespec *start)
 {
-    if (x < 0 || x >= display->width || y < 0 || y >= display->height) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Measure per-transaction latency with NOP commands and data throughput
+ * with full frames (caller holds the bus lock) */
+static int ssd1306_calibrate_locked(ssd1306_t *display, unsigned char *frame, int rounds)
+{
+    struct timespec start;
+    unsigned long bytes;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++) {
+        if (ssd1306_command(display, SSD1306_NOP) != 0) return -1;
+    }
+    display->bus_txn_latency_us = ssd1306_elapsed_us(&start) / rounds;
+
+    if (ssd1306_set_window(display, 0, display->width - 1, 0, display->pages - 1) != 0) return -1;
+
+    bytes = display->bytes_sent;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++) {
+        if (ssd1306_data(display, frame, display->buffer_size) != 0) return -1;
+    }
+    double elapsed = ssd1306_elapsed_us(&start);
+    display->bus_bytes_per_sec = (elapsed > 0) ? (display->bytes_sent - bytes) * 1e6 / elapsed : 0;
+
+    return 0;
+}
+
+/* Calibrate the bus. The frames resend what the panel already shows when
+ * the shadow is valid, so calibration is invisible on screen. */
+int ssd1306_calibrate(ssd1306_t *display, int rounds)
+{
+    unsigned char *frame;
+    int result;
+
+    if (rounds < 1) rounds = 1;
+
+    if (display->async_running) {
+        ssd1306_async_wait(display);
+    }
+
+    pthread_mutex_lock(&display->bus_lock);
+
+    frame = display->shadow_valid ? display->shadow : display->buffer;
+    result = ssd1306_calibrate_locked(display, frame, rounds);
+
+    if (result == 0 && frame == display->buffer) {
+        memcpy(display->shadow, display->buffer, display->buffer_size);
+        display->shadow_valid = 1;
+    }
+
+    pthread_mutex_unlock(&display->bus_lock);
+    return result;
+}
+
+/* Mark a rectangle (inclusive pixel coordinates) as needing transfer */
+void ssd1306_mark_dirty(ssd1306_t *display, int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= display->width) x1 = display->width - 1;
+    if (y1 >= display->height) y1 = display->height - 1;
+    if (x1 < x0 || y1 < y0) {
         return;
     }
 
+    for (int page = y0 / 8; page <= y1 / 8; page++) {
+        if (x0 < display->dirty_x0[page]) display->dirty_x0[page] = x0;
+        if (x1 > display->dirty_x1[page]) display->dirty_x1[page] = x1;
+    }
+}
+
+/* Mark the entire buffer as needing transfer */
+void ssd1306_mark_all_dirty(ssd1306_t *display)
+{
+    for (int page = 0; page < display->pages; page++) {
+        display->dirty_x0[page] = 0;
+        display->dirty_x1[page] = display->width - 1;
+    }
+}
+
+/* Set pixel in buffer; pixels outside the clip rectangle are discarded */
+void ssd1306_set_pixel_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y, int color)
+{
+    if (x < display->clip_x0 || x > display->clip_x1 || y < display->clip_y0 || y > display->clip_y1) {
+        return;
+    }
+
+    if (display->rotation & 1) {
+        ssd1306_coord_t column = display->width - 1 - y;
+        y = x;
+        x = column;
+    }
+
+    if (display->start_line) {
+        y = ssd1306_ram_row(display, y);
+    }
+
     int page = y / 8;
     int bit = y % 8;
     int index = x + (page * display->width);
@@ -223,15 +988,28 @@ void ssd1306_set_pixel_internal(ssd1306_t *display, int x, int y, int color)
             display->buffer[index] ^= (1 << bit);
             break;
     }
+
+    if (x < display->dirty_x0[page]) display->dirty_x0[page] = x;
+    if (x > display->dirty_x1[page]) display->dirty_x1[page] = x;
 }
 
 /* Get pixel from buffer */
-int ssd1306_get_pixel_internal(ssd1306_t *display, int x, int y)
+int ssd1306_get_pixel_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y)
 {
-    if (x < 0 || x >= display->width || y < 0 || y >= display->height) {
+    if (x < 0 || x >= ssd1306_logical_width(display) || y < 0 || y >= ssd1306_logical_height(display)) {
         return 0;
     }
 
+    if (display->rotation & 1) {
+        ssd1306_coord_t column = display->width - 1 - y;
+        y = x;
+        x = column;
+    }
+
+    if (display->start_line) {
+        y = ssd1306_ram_row(display, y);
+    }
+
     int page = y / 8;
     int bit = y % 8;
     int index = x + (page * display->width);
@@ -243,13 +1021,25 @@ int ssd1306_get_pixel_internal(ssd1306_t *display, int x, int y)
 void ssd1306_cleanup(ssd1306_t *display)
 {
     if (display) {
-        if (display->i2c_fd >= 0) {
+        /* Stop flushing shared frames and drop the mapping (clients draw
+         * straight into it, so their buffer goes with it) */
+        ssd1306_shared_detach(display);
+
+        /* Drain and stop the background worker before the bus goes away */
+        ssd1306_async_stop(display);
+
+        if (display->transport) {
             /* Turn off display before closing */
             ssd1306_command(display, SSD1306_DISPLAYOFF);
-            close(display->i2c_fd);
+            display->transport->close(display);
+            display->transport = NULL;
         }
+        ssd1306_async_destroy(display);
         if (display->buffer) {
-            free(display->buffer);
+            free(display->buffer - SSD1306_BUFFER_HEADROOM);
+        }
+        if (display->dirty_x0) {
+            free(display->dirty_x0);
         }
     }
 }
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <limits.h>
 
 /* Complete 5x7 font for ASCII characters 32-126 */
 static const unsigned char font5x7[][5] = {
@@ -116,24 +117,31 @@ static const unsigned char font5x7[][5] = {
     {0x10, 0x08, 0x08, 0x10, 0x08}, // 126 ~
 };
 
+#ifndef SSD1306_NO_PHP_API
+
 /* PHP Graphics Functions */
 
 /* {{{ proto void ssd1306_draw_pixel(int x, int y, int color)
    Draw a pixel at specified coordinates */
 PHP_FUNCTION(ssd1306_draw_pixel)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long x, y, color;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "lll", &x, &y, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    ssd1306_set_pixel_internal(SSD1306_G(display), x, y, color);
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_set_pixel_internal(display, x, y, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
@@ -141,39 +149,71 @@ PHP_FUNCTION(ssd1306_draw_pixel)
    Draw a line between two points */
 PHP_FUNCTION(ssd1306_draw_line)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long x0, y0, x1, y1, color;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllll", &x0, &y0, &x1, &y1, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    /* Bresenham's line algorithm */
-    int dx = abs(x1 - x0);
-    int dy = abs(y1 - y0);
-    int sx = (x0 < x1) ? 1 : -1;
-    int sy = (y0 < y1) ? 1 : -1;
-    int err = dx - dy;
+    uint64_t start = ssd1306_now_ns();
 
-    while (1) {
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0, y0, color);
-        
-        if (x0 == x1 && y0 == y1) break;
-        
-        int e2 = 2 * err;
-        if (e2 > -dy) {
-            err -= dy;
-            x0 += sx;
-        }
-        if (e2 < dx) {
-            err += dx;
-            y0 += sy;
-        }
+    ssd1306_draw_line_internal(display, x0, y0, x1, y1, color);
+
+    ssd1306_count_render(display, start);
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_draw_fast_hline(int x, int y, int w, int color)
+   Draw a horizontal line w pixels long */
+PHP_FUNCTION(ssd1306_draw_fast_hline)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y, w, color;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &x, &y, &w, &color) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_draw_fast_hline_internal(display, x, y, w, color);
+
+    ssd1306_count_render(display, start);
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_draw_fast_vline(int x, int y, int h, int color)
+   Draw a vertical line h pixels long */
+PHP_FUNCTION(ssd1306_draw_fast_vline)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y, h, color;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &x, &y, &h, &color) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
     }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_draw_fast_vline_internal(display, x, y, h, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
@@ -181,26 +221,23 @@ PHP_FUNCTION(ssd1306_draw_line)
    Draw a rectangle outline */
 PHP_FUNCTION(ssd1306_draw_rect)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long x, y, w, h, color;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllll", &x, &y, &w, &h, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    /* Draw rectangle outline */
-    for (int i = 0; i < w; i++) {
-        ssd1306_set_pixel_internal(SSD1306_G(display), x + i, y, color);         /* Top */
-        ssd1306_set_pixel_internal(SSD1306_G(display), x + i, y + h - 1, color); /* Bottom */
-    }
-    for (int i = 0; i < h; i++) {
-        ssd1306_set_pixel_internal(SSD1306_G(display), x, y + i, color);         /* Left */
-        ssd1306_set_pixel_internal(SSD1306_G(display), x + w - 1, y + i, color); /* Right */
-    }
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_draw_rect_internal(display, x, y, w, h, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
@@ -208,23 +245,23 @@ PHP_FUNCTION(ssd1306_draw_rect)
    Draw a filled rectangle */
 PHP_FUNCTION(ssd1306_fill_rect)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long x, y, w, h, color;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllll", &x, &y, &w, &h, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    /* Fill rectangle */
-    for (int j = 0; j < h; j++) {
-        for (int i = 0; i < w; i++) {
-            ssd1306_set_pixel_internal(SSD1306_G(display), x + i, y + j, color);
-        }
-    }
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_fill_rect_internal(display, x, y, w, h, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
@@ -232,41 +269,23 @@ PHP_FUNCTION(ssd1306_fill_rect)
    Draw a circle outline */
 PHP_FUNCTION(ssd1306_draw_circle)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long x0, y0, r, color;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &x0, &y0, &r, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    /* Bresenham's circle algorithm */
-    int x = 0;
-    int y = r;
-    int d = 3 - 2 * r;
+    uint64_t start = ssd1306_now_ns();
 
-    while (y >= x) {
-        /* Draw 8 octants */
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 + x, y0 + y, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 - x, y0 + y, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 + x, y0 - y, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 - x, y0 - y, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 + y, y0 + x, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 - y, y0 + x, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 + y, y0 - x, color);
-        ssd1306_set_pixel_internal(SSD1306_G(display), x0 - y, y0 - x, color);
+    ssd1306_draw_circle_internal(display, x0, y0, r, color);
 
-        if (d < 0) {
-            d = d + 4 * x + 6;
-        } else {
-            d = d + 4 * (x - y) + 10;
-            y--;
-        }
-        x++;
-    }
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
@@ -274,220 +293,2111 @@ PHP_FUNCTION(ssd1306_draw_circle)
    Draw a filled circle */
 PHP_FUNCTION(ssd1306_fill_circle)
 {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
     zend_long x0, y0, r, color;
 
     if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &x0, &y0, &r, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    /* Fill circle using horizontal lines */
-    for (int y = -r; y <= r; y++) {
-        for (int x = -r; x <= r; x++) {
-            if (x * x + y * y <= r * r) {
-                ssd1306_set_pixel_internal(SSD1306_G(display), x0 + x, y0 + y, color);
-            }
-        }
-    }
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_fill_circle_internal(display, x0, y0, r, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
-/* {{{ proto void ssd1306_print(string text)
-   Print text at current cursor position */
-PHP_FUNCTION(ssd1306_print)
+/* {{{ proto void ssd1306_fill_round_rect(int x, int y, int w, int h, int r, int color)
+   Draw a filled rectangle with rounded corners */
+PHP_FUNCTION(ssd1306_fill_round_rect)
 {
-    char *text;
-    size_t text_len;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y, w, h, r, color;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "s", &text, &text_len) == FAILURE) {
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llllll", &x, &y, &w, &h, &r, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    ssd1306_t *display = SSD1306_G(display);
-    
-    for (size_t i = 0; i < text_len; i++) {
-        char c = text[i];
-        
-        if (c == '\n') {
-            display->cursor_y += 8 * display->text_size;
-            display->cursor_x = 0;
-            continue;
-        }
-        
-        if (c == '\r') {
-            display->cursor_x = 0;
-            continue;
-        }
-        
-        /* Handle character wrapping */
-        if (display->wrap && (display->cursor_x + 6 * display->text_size > display->width)) {
-            display->cursor_x = 0;
-            display->cursor_y += 8 * display->text_size;
-        }
-        
-        /* Skip if we're past the bottom */
-        if (display->cursor_y >= display->height) {
-            break;
-        }
-        
-        /* Draw character */
-        ssd1306_draw_char_internal(display, display->cursor_x, display->cursor_y, c, 
-                                  display->text_color, display->text_bg_color, display->text_size);
-        
-        display->cursor_x += 6 * display->text_size;
-    }
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_fill_round_rect_internal(display, x, y, w, h, r, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
-/* {{{ proto void ssd1306_set_cursor(int x, int y)
-   Set text cursor position */
-PHP_FUNCTION(ssd1306_set_cursor)
+/* {{{ proto void ssd1306_draw_ellipse(int x0, int y0, int rx, int ry, int color)
+   Draw an ellipse outline */
+PHP_FUNCTION(ssd1306_draw_ellipse)
 {
-    zend_long x, y;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x0, y0, rx, ry, color;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &x, &y) == FAILURE) {
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllll", &x0, &y0, &rx, &ry, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    SSD1306_G(display)->cursor_x = x;
-    SSD1306_G(display)->cursor_y = y;
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_draw_ellipse_internal(display, x0, y0, rx, ry, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
-/* {{{ proto void ssd1306_set_text_size(int size)
-   Set text size multiplier */
-PHP_FUNCTION(ssd1306_set_text_size)
+/* {{{ proto void ssd1306_fill_ellipse(int x0, int y0, int rx, int ry, int color)
+   Draw a filled ellipse */
+PHP_FUNCTION(ssd1306_fill_ellipse)
 {
-    zend_long size;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x0, y0, rx, ry, color;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &size) == FAILURE) {
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllll", &x0, &y0, &rx, &ry, &color) == FAILURE) {
         return;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
         return;
     }
 
-    if (size < 1) size = 1;
-    SSD1306_G(display)->text_size = size;
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_fill_ellipse_internal(display, x0, y0, rx, ry, color);
+
+    ssd1306_count_render(display, start);
 }
 /* }}} */
 
-/* {{{ proto void ssd1306_set_text_color(int color)
-   Set text color */
-PHP_FUNCTION(ssd1306_set_text_color)
+/* {{{ proto bool ssd1306_set_clip(int x, int y, int w, int h)
+   Restrict drawing to a rectangle; pixels outside it are left untouched */
+PHP_FUNCTION(ssd1306_set_clip)
 {
-    zend_long color;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y, w, h;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &color) == FAILURE) {
-        return;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &x, &y, &w, &h) == FAILURE) {
+        RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
-        return;
+        RETURN_FALSE;
     }
 
-    SSD1306_G(display)->text_color = color;
+    ssd1306_set_clip_internal(display, x, y, w, h);
+    RETURN_TRUE;
 }
 /* }}} */
 
-/* {{{ proto int ssd1306_get_width()
-   Get display width */
-PHP_FUNCTION(ssd1306_get_width)
+/* {{{ proto bool ssd1306_reset_clip()
+   Let drawing reach the whole panel again */
+PHP_FUNCTION(ssd1306_reset_clip)
 {
-    if (!SSD1306_G(display)) {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
-        RETURN_LONG(0);
+        RETURN_FALSE;
     }
 
-    RETURN_LONG(SSD1306_G(display)->width);
+    ssd1306_reset_clip_internal(display);
+    RETURN_TRUE;
 }
 /* }}} */
 
-/* {{{ proto int ssd1306_get_height()
-   Get display height */
-PHP_FUNCTION(ssd1306_get_height)
+/* {{{ proto array ssd1306_get_clip()
+   Get the clip rectangle as [x, y, w, h]; w and h are 0 when it is empty */
+PHP_FUNCTION(ssd1306_get_clip)
 {
-    if (!SSD1306_G(display)) {
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
-        RETURN_LONG(0);
+        RETURN_FALSE;
     }
 
-    RETURN_LONG(SSD1306_G(display)->height);
+    int empty = display->clip_x1 < display->clip_x0;
+
+    array_init(return_value);
+    add_next_index_long(return_value, display->clip_x0);
+    add_next_index_long(return_value, display->clip_y0);
+    add_next_index_long(return_value, empty ? 0 : display->clip_x1 - display->clip_x0 + 1);
+    add_next_index_long(return_value, empty ? 0 : display->clip_y1 - display->clip_y0 + 1);
 }
 /* }}} */
 
-/* {{{ proto int ssd1306_get_pixel(int x, int y)
-   Get pixel color at coordinates */
-PHP_FUNCTION(ssd1306_get_pixel)
+/* {{{ proto string ssd1306_get_buffer([int format])
+   Get the whole framebuffer as a binary string, in page order by default */
+PHP_FUNCTION(ssd1306_get_buffer)
 {
-    zend_long x, y;
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long format = SSD1306_FORMAT_PAGE;
+    zend_string *frame;
+    size_t size = 0;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &x, &y) == FAILURE) {
-        RETURN_LONG(0);
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|l", &format) == FAILURE) {
+        RETURN_FALSE;
     }
 
-    if (!SSD1306_G(display)) {
+    if (!display) {
         php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
-        RETURN_LONG(0);
+        RETURN_FALSE;
+    }
+
+    if (format >= 0 && format <= SSD1306_FORMAT_BYTE) {
+        size = ssd1306_buffer_format_size(display, format);
+    }
+    if (!size) {
+        php_error_docref(NULL, E_WARNING, "Unknown SSD1306 buffer format " ZEND_LONG_FMT, format);
+        RETURN_FALSE;
     }
 
-    RETURN_LONG(ssd1306_get_pixel_internal(SSD1306_G(display), x, y));
+    frame = zend_string_alloc(size, 0);
+    ssd1306_export_buffer(display, format, (unsigned char *) ZSTR_VAL(frame));
+    ZSTR_VAL(frame)[size] = '\0';
+    RETURN_STR(frame);
 }
 /* }}} */
 
-/* Internal function to draw a character */
-void ssd1306_draw_char_internal(ssd1306_t *display, int x, int y, char c, int color, int bg, int size)
+/* {{{ proto bool ssd1306_set_buffer(string frame [, int offset [, int format]])
+   Load frame data into the framebuffer, offset bytes into the format's layout */
+PHP_FUNCTION(ssd1306_set_buffer)
 {
-    if (c < 32 || c > 126) c = 32; /* Replace non-printable with space */
-    
-    int char_index = c - 32;
-    if (char_index >= sizeof(font5x7) / sizeof(font5x7[0])) {
-        char_index = 0; /* Default to space */
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    char *frame;
+    size_t frame_len, size = 0;
+    zend_long offset = 0, format = SSD1306_FORMAT_PAGE;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "s|ll", &frame, &frame_len, &offset, &format) == FAILURE) {
+        RETURN_FALSE;
     }
-    
-    for (int i = 0; i < 5; i++) {
-        unsigned char line = font5x7[char_index][i];
-        for (int j = 0; j < 8; j++) {
-            if (line & (1 << j)) {
-                if (size == 1) {
-                    ssd1306_set_pixel_internal(display, x + i, y + j, color);
-                } else {
-                    /* Draw scaled character */
-                    for (int a = 0; a < size; a++) {
-                        for (int b = 0; b < size; b++) {
-                            ssd1306_set_pixel_internal(display, x + i * size + a, y + j * size + b, color);
-                        }
-                    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (format >= 0 && format <= SSD1306_FORMAT_BYTE) {
+        size = ssd1306_buffer_format_size(display, format);
+    }
+    if (!size) {
+        php_error_docref(NULL, E_WARNING, "Unknown SSD1306 buffer format " ZEND_LONG_FMT, format);
+        RETURN_FALSE;
+    }
+
+    if (offset < 0 || (size_t) offset > size || frame_len > size - offset) {
+        php_error_docref(NULL, E_WARNING, "%zu bytes at offset " ZEND_LONG_FMT " do not fit the %zu byte buffer",
+                         frame_len, offset, size);
+        RETURN_FALSE;
+    }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_import_buffer(display, format, (const unsigned char *) frame, frame_len, offset);
+
+    ssd1306_count_render(display, start);
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_draw_bitmap(int x, int y, string data, int w, int h, int color [, int bg [, int format [, string mask]]])
+   Draw a 1 bit per pixel bitmap; clear bits are transparent unless bg is a color */
+PHP_FUNCTION(ssd1306_draw_bitmap)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y, w, h, color, bg = -1, format = SSD1306_FORMAT_ROW;
+    char *data, *mask = NULL;
+    size_t data_len, mask_len = 0, size;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llslll|lls!", &x, &y, &data, &data_len, &w, &h, &color,
+                              &bg, &format, &mask, &mask_len) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (format < 0 || format > SSD1306_FORMAT_BYTE) {
+        php_error_docref(NULL, E_WARNING, "Unknown SSD1306 bitmap format " ZEND_LONG_FMT, format);
+        RETURN_FALSE;
+    }
+
+    if (w <= 0 || h <= 0) {
+        RETURN_TRUE;
+    }
+
+    if (w > SSD1306_MAX_BITMAP || h > SSD1306_MAX_BITMAP) {
+        php_error_docref(NULL, E_WARNING, "Bitmap of " ZEND_LONG_FMT "x" ZEND_LONG_FMT " pixels exceeds %d pixels a side",
+                         w, h, SSD1306_MAX_BITMAP);
+        RETURN_FALSE;
+    }
+
+    size = ssd1306_bitmap_size(format, w, h);
+    if (data_len < size || (mask && mask_len < size)) {
+        php_error_docref(NULL, E_WARNING, "A " ZEND_LONG_FMT "x" ZEND_LONG_FMT " bitmap needs %zu bytes of data and mask",
+                         w, h, size);
+        RETURN_FALSE;
+    }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_draw_bitmap_internal(display, x, y, (const unsigned char *) data, (const unsigned char *) mask,
+                                 w, h, format, color, (bg >= 0 && bg <= SSD1306_INVERSE) ? bg : -1);
+
+    ssd1306_count_render(display, start);
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_copy_rect(int sx, int sy, int w, int h, int dx, int dy)
+   Copy a rectangle of the framebuffer to another position; the two may overlap */
+PHP_FUNCTION(ssd1306_copy_rect)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long sx, sy, w, h, dx, dy;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llllll", &sx, &sy, &w, &h, &dx, &dy) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_copy_rect_internal(display, sx, sy, w, h, dx, dy);
+
+    ssd1306_count_render(display, start);
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_scroll_region(int x, int y, int w, int h, int dx, int dy [, int fill = SSD1306_BLACK])
+   Scroll the contents of a rectangle, filling the pixels it vacates (-1 keeps them) */
+PHP_FUNCTION(ssd1306_scroll_region)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y, w, h, dx, dy, fill = SSD1306_BLACK;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llllll|l", &x, &y, &w, &h, &dx, &dy, &fill) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_scroll_region_internal(display, x, y, w, h, dx, dy,
+                                   (fill >= 0 && fill <= SSD1306_INVERSE) ? fill : -1);
+
+    ssd1306_count_render(display, start);
+}
+/* }}} */
+
+/* Argument layouts of the array form of each batch primitive, after the
+   opcode: l a number, s a string, | starts the optional ones */
+static const char *ssd1306_batch_specs[] = {
+    [SSD1306_DRAW_PIXEL]       = "lll",
+    [SSD1306_DRAW_LINE]        = "lllll",
+    [SSD1306_DRAW_HLINE]       = "llll",
+    [SSD1306_DRAW_VLINE]       = "llll",
+    [SSD1306_DRAW_RECT]        = "lllll",
+    [SSD1306_DRAW_FILL_RECT]   = "lllll",
+    [SSD1306_DRAW_CIRCLE]      = "llll",
+    [SSD1306_DRAW_FILL_CIRCLE] = "llll",
+    [SSD1306_DRAW_CHAR]        = "llsl|ll",
+    [SSD1306_DRAW_TEXT]        = "lls",
+    [SSD1306_DRAW_BITMAP]      = "llslll|lls",
+};
+
+/* Decode one array-form batch primitive. Strings stay owned by the array.
+   Returns NULL, or why the primitive is malformed. */
+static const char *ssd1306_batch_decode(zval *entry, ssd1306_draw_op_t *op)
+{
+    const char *spec = NULL;
+    zval *arg;
+
+    memset(op, 0, sizeof(*op));
+
+    ZVAL_DEREF(entry);
+    if (Z_TYPE_P(entry) != IS_ARRAY) {
+        return "Primitive must be an array";
+    }
+
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(entry), arg) {
+        ZVAL_DEREF(arg);
+
+        if (!spec) {
+            if (Z_TYPE_P(arg) != IS_LONG || Z_LVAL_P(arg) < SSD1306_DRAW_PIXEL || Z_LVAL_P(arg) > SSD1306_DRAW_BITMAP) {
+                return "Unknown primitive";
+            }
+            op->op = Z_LVAL_P(arg);
+            spec = ssd1306_batch_specs[op->op];
+            continue;
+        }
+
+        if (*spec == '|') {
+            spec++;
+        }
+
+        switch (*spec++) {
+            case 'l':
+                switch (Z_TYPE_P(arg)) {
+                    case IS_LONG:   op->arg[op->argc++] = Z_LVAL_P(arg); break;
+                    case IS_DOUBLE: op->arg[op->argc++] = zend_dval_to_lval(Z_DVAL_P(arg)); break;
+                    case IS_TRUE:   op->arg[op->argc++] = 1; break;
+                    case IS_FALSE:  op->arg[op->argc++] = 0; break;
+                    default:        return "Expected a number";
                 }
-            } else if (bg != color) {
-                if (size == 1) {
-                    ssd1306_set_pixel_internal(display, x + i, y + j, bg);
+                break;
+
+            case 's':
+                if (op->data) {
+                    /* A bitmap mask may be left out with null */
+                    if (Z_TYPE_P(arg) == IS_NULL) {
+                        break;
+                    }
+                    if (Z_TYPE_P(arg) != IS_STRING) {
+                        return "Expected a string";
+                    }
+                    op->mask = (const unsigned char *) Z_STRVAL_P(arg);
+                    op->mask_len = Z_STRLEN_P(arg);
                 } else {
-                    /* Draw scaled background */
-                    for (int a = 0; a < size; a++) {
-                        for (int b = 0; b < size; b++) {
-                            ssd1306_set_pixel_internal(display, x + i * size + a, y + j * size + b, bg);
-                        }
+                    if (Z_TYPE_P(arg) != IS_STRING) {
+                        return "Expected a string";
                     }
+                    op->data = (const unsigned char *) Z_STRVAL_P(arg);
+                    op->data_len = Z_STRLEN_P(arg);
                 }
-            }
+                break;
+
+            default:
+                return "Too many arguments";
         }
+    } ZEND_HASH_FOREACH_END();
+
+    if (!spec) {
+        return "Unknown primitive";
     }
+    if (*spec && *spec != '|') {
+        return "Missing arguments";
+    }
+    return NULL;
+}
+
+static void ssd1306_batch_error(void *ctx, size_t index, const char *message)
+{
+    add_index_string((zval *) ctx, index, message);
+}
+
+/* {{{ proto array ssd1306_draw_batch(array|string ops)
+   Draw a list of primitives in one call; returns the errors keyed by position */
+PHP_FUNCTION(ssd1306_draw_batch)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zval *ops, *entry;
+    zend_string *key;
+    zend_ulong index;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &ops) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_FALSE;
+    }
+
+    if (Z_TYPE_P(ops) != IS_ARRAY && Z_TYPE_P(ops) != IS_STRING) {
+        php_error_docref(NULL, E_WARNING, "Draw batch must be an array or a packed string");
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+
+    uint64_t start = ssd1306_now_ns();
+
+    if (Z_TYPE_P(ops) == IS_STRING) {
+        ssd1306_draw_packed_internal(display, (const unsigned char *) Z_STRVAL_P(ops), Z_STRLEN_P(ops),
+                                     ssd1306_batch_error, return_value);
+    } else {
+        ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(ops), index, key, entry) {
+            ssd1306_draw_op_t op;
+            const char *message = ssd1306_batch_decode(entry, &op);
+
+            if (!message) {
+                message = ssd1306_draw_op_internal(display, &op);
+            }
+            if (message) {
+                if (key) {
+                    add_assoc_string_ex(return_value, ZSTR_VAL(key), ZSTR_LEN(key), (char *) message);
+                } else {
+                    add_index_string(return_value, index, message);
+                }
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    ssd1306_count_render(display, start);
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_print(string text)
+   Print text at current cursor position */
+PHP_FUNCTION(ssd1306_print)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    char *text;
+    size_t text_len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "s", &text, &text_len) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    uint64_t start = ssd1306_now_ns();
+
+    ssd1306_print_internal(display, text, text_len);
+
+    ssd1306_count_render(display, start);
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_set_cursor(int x, int y)
+   Set text cursor position */
+PHP_FUNCTION(ssd1306_set_cursor)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &x, &y) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    display->cursor_x = x;
+    display->cursor_y = y;
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_set_text_size(int size)
+   Set text size multiplier */
+PHP_FUNCTION(ssd1306_set_text_size)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long size;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &size) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    if (size < 1) size = 1;
+    display->text_size = size;
+}
+/* }}} */
+
+/* {{{ proto void ssd1306_set_text_color(int color)
+   Set text color */
+PHP_FUNCTION(ssd1306_set_text_color)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long color;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &color) == FAILURE) {
+        return;
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return;
+    }
+
+    display->text_color = color;
+}
+/* }}} */
+
+/* {{{ proto int ssd1306_get_width()
+   Get display width */
+PHP_FUNCTION(ssd1306_get_width)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_LONG(0);
+    }
+
+    RETURN_LONG(ssd1306_logical_width(display));
+}
+/* }}} */
+
+/* {{{ proto int ssd1306_get_height()
+   Get display height */
+PHP_FUNCTION(ssd1306_get_height)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_LONG(0);
+    }
+
+    RETURN_LONG(ssd1306_logical_height(display));
+}
+/* }}} */
+
+/* {{{ proto int ssd1306_get_pixel(int x, int y)
+   Get pixel color at coordinates */
+PHP_FUNCTION(ssd1306_get_pixel)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    zend_long x, y;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &x, &y) == FAILURE) {
+        RETURN_LONG(0);
+    }
+
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        RETURN_LONG(0);
+    }
+
+    RETURN_LONG(ssd1306_get_pixel_internal(display, x, y));
+}
+/* }}} */
+
+/* Internal function to draw a character */
+
+#endif /* SSD1306_NO_PHP_API */
+
+/* Rasterizer */
+
+/* Largest radius whose squared terms fit the 64-bit boundary test */
+#define SSD1306_MAX_RADIUS 0x7FFF
+
+/* Lines with every coordinate within this bound are stepped with exact
+ * 64-bit arithmetic; longer ones are first cut down to the clip rectangle */
+#define SSD1306_LINE_EXACT (1L << 29)
+
+/* Last coordinate of a run of len >= 1 pixels, saturating instead of
+ * overflowing */
+static inline ssd1306_coord_t ssd1306_span_end(ssd1306_coord_t start, ssd1306_coord_t len)
+{
+    return (start > INT64_MAX - (len - 1)) ? INT64_MAX : start + (len - 1);
+}
+
+/* Whether the box x0..x1, y0..y1 misses the clip rectangle */
+static inline int ssd1306_clip_rejects(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                       ssd1306_coord_t x1, ssd1306_coord_t y1)
+{
+    return x1 < display->clip_x0 || x0 > display->clip_x1 || y1 < display->clip_y0 || y0 > display->clip_y1;
+}
+
+/* Restrict drawing to a rectangle, intersected with the panel */
+void ssd1306_set_clip_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                               ssd1306_coord_t w, ssd1306_coord_t h)
+{
+    ssd1306_coord_t x0 = x, y0 = y, x1, y1;
+
+    if (w <= 0 || h <= 0) {
+        x0 = y0 = 0;
+        x1 = y1 = -1;
+    } else {
+        x1 = ssd1306_span_end(x, w);
+        y1 = ssd1306_span_end(y, h);
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 >= ssd1306_logical_width(display)) x1 = ssd1306_logical_width(display) - 1;
+        if (y1 >= ssd1306_logical_height(display)) y1 = ssd1306_logical_height(display) - 1;
+        if (x1 < x0 || y1 < y0) {
+            x0 = y0 = 0;
+            x1 = y1 = -1;
+        }
+    }
+
+    display->clip_x0 = x0;
+    display->clip_y0 = y0;
+    display->clip_x1 = x1;
+    display->clip_y1 = y1;
+}
+
+/* Let drawing reach the whole panel again */
+void ssd1306_reset_clip_internal(ssd1306_t *display)
+{
+    display->clip_x0 = 0;
+    display->clip_y0 = 0;
+    display->clip_x1 = ssd1306_logical_width(display) - 1;
+    display->clip_y1 = ssd1306_logical_height(display) - 1;
+}
+
+/* Number of panel rows from y to at most y1 whose display RAM rows follow
+ * on from ram_row(y), which is stored in *ram. A run ends where the start
+ * line wraps the scroll area or where the area begins or ends. */
+static int ssd1306_ram_run(ssd1306_t *display, int y, int y1, int *ram)
+{
+    int top = display->scroll_area_top;
+    int end = top + display->scroll_area_rows - 1;
+
+    *ram = ssd1306_ram_row(display, y);
+
+    if (y < top) {
+        if (y1 >= top) y1 = top - 1;
+    } else if (y <= end) {
+        if (y1 > y + (end - *ram)) y1 = y + (end - *ram);
+        if (y1 > end) y1 = end;
+    }
+
+    return y1 - y + 1;
+}
+
+/* Mark panel rows y0..y1 of columns x0..x1 as needing transfer */
+static void ssd1306_mark_rows(ssd1306_t *display, int x0, int y0, int x1, int y1)
+{
+    int ram, n;
+
+    if (!display->start_line) {
+        ssd1306_mark_dirty(display, x0, y0, x1, y1);
+        return;
+    }
+
+    for (; y0 <= y1; y0 += n) {
+        n = ssd1306_ram_run(display, y0, y1, &ram);
+        ssd1306_mark_dirty(display, x0, ram, x1, ram + n - 1);
+    }
+}
+
+/* Mark a box given in drawing coordinates as needing transfer */
+static void ssd1306_mark_box(ssd1306_t *display, int x0, int y0, int x1, int y1)
+{
+    if (display->rotation & 1) {
+        ssd1306_mark_rows(display, display->width - 1 - y1, x0, display->width - 1 - y0, x1);
+    } else {
+        ssd1306_mark_rows(display, x0, y0, x1, y1);
+    }
+}
+
+/* Apply a bit mask to columns x0..x1 of one page: OR for white, AND-NOT
+ * for black, XOR for inverse. Whole bytes of white or black are a memset. */
+static void ssd1306_fill_page_span(ssd1306_t *display, int page, int x0, int x1, unsigned char mask, int color)
+{
+    unsigned char *p = display->buffer + page * display->width + x0;
+    unsigned char *end = p + (x1 - x0 + 1);
+
+    switch (color) {
+        case SSD1306_WHITE:
+            if (mask == 0xFF) {
+                memset(p, 0xFF, end - p);
+            } else {
+                for (; p < end; p++) *p |= mask;
+            }
+            break;
+        case SSD1306_BLACK:
+            if (mask == 0xFF) {
+                memset(p, 0x00, end - p);
+            } else {
+                for (; p < end; p++) *p &= ~mask;
+            }
+            break;
+        case SSD1306_INVERSE:
+            for (; p < end; p++) *p ^= mask;
+            break;
+    }
+}
+
+/* Fill display RAM rows y0..y1 of columns x0..x1 a page at a time, with
+ * masks for the partly covered top and bottom pages */
+static void ssd1306_fill_rows(ssd1306_t *display, int x0, int y0, int x1, int y1, int color)
+{
+    int page0 = y0 / 8;
+    int page1 = y1 / 8;
+
+    for (int page = page0; page <= page1; page++) {
+        unsigned char mask = 0xFF;
+
+        if (page == page0) mask &= 0xFF << (y0 & 7);
+        if (page == page1) mask &= 0xFF >> (7 - (y1 & 7));
+
+        ssd1306_fill_page_span(display, page, x0, x1, mask, color);
+    }
+
+    ssd1306_mark_dirty(display, x0, y0, x1, y1);
+}
+
+/* Fill the box x0..x1, y0..y1 (inclusive). It is clipped once, turned onto
+ * the panel's axes when rotated a quarter turn, then filled in runs of
+ * display RAM rows. */
+static void ssd1306_fill_box(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                             ssd1306_coord_t x1, ssd1306_coord_t y1, int color)
+{
+    if (x0 < display->clip_x0) x0 = display->clip_x0;
+    if (y0 < display->clip_y0) y0 = display->clip_y0;
+    if (x1 > display->clip_x1) x1 = display->clip_x1;
+    if (y1 > display->clip_y1) y1 = display->clip_y1;
+    if (x1 < x0 || y1 < y0) {
+        return;
+    }
+
+    if (display->rotation & 1) {
+        ssd1306_coord_t top = x0, bottom = x1;
+
+        x0 = display->width - 1 - y1;
+        x1 = display->width - 1 - y0;
+        y0 = top;
+        y1 = bottom;
+    }
+
+    if (!display->start_line) {
+        ssd1306_fill_rows(display, x0, y0, x1, y1, color);
+        return;
+    }
+
+    /* Rows shifted by the start line wrap around the scroll area */
+    for (int y = y0, ram, n; y <= y1; y += n) {
+        n = ssd1306_ram_run(display, y, y1, &ram);
+        ssd1306_fill_rows(display, x0, ram, x1, ram + n - 1, color);
+    }
+}
+
+/* Draw a filled rectangle */
+void ssd1306_fill_rect_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                ssd1306_coord_t w, ssd1306_coord_t h, int color)
+{
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    ssd1306_fill_box(display, x, y, ssd1306_span_end(x, w), ssd1306_span_end(y, h), color);
+}
+
+/* Draw a horizontal line: one bit in each column of a single page */
+void ssd1306_draw_fast_hline_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                      ssd1306_coord_t w, int color)
+{
+    if (w <= 0) {
+        return;
+    }
+
+    ssd1306_fill_box(display, x, y, ssd1306_span_end(x, w), y, color);
+}
+
+/* Draw a vertical line: whole byte masks down one column */
+void ssd1306_draw_fast_vline_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                      ssd1306_coord_t h, int color)
+{
+    if (h <= 0) {
+        return;
+    }
+
+    ssd1306_fill_box(display, x, y, x, ssd1306_span_end(y, h), color);
+}
+
+/* Cut a line down to the clip rectangle plus a one pixel margin
+ * (Liang-Barsky), rounding the new endpoints. Returns 0 if it misses. Long
+ * double keeps a 64-bit mantissa where zend_long is 64 bits wide (x86-64,
+ * AArch64); 32-bit coordinates are exact in any of them. */
+static int ssd1306_clip_line(ssd1306_t *display, ssd1306_coord_t *x0, ssd1306_coord_t *y0,
+                             ssd1306_coord_t *x1, ssd1306_coord_t *y1)
+{
+    long double ax = *x0, ay = *y0;
+    long double dx = (long double) *x1 - ax, dy = (long double) *y1 - ay;
+    long double p[4] = {-dx, dx, -dy, dy};
+    long double q[4] = {
+        ax - (display->clip_x0 - 1), (display->clip_x1 + 1) - ax,
+        ay - (display->clip_y0 - 1), (display->clip_y1 + 1) - ay
+    };
+    long double t0 = 0.0L, t1 = 1.0L;
+
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0.0L) {
+            if (q[i] < 0.0L) {
+                return 0;
+            }
+            continue;
+        }
+
+        long double t = q[i] / p[i];
+        if (p[i] < 0.0L) {
+            if (t > t1) return 0;
+            if (t > t0) t0 = t;
+        } else {
+            if (t < t0) return 0;
+            if (t < t1) t1 = t;
+        }
+    }
+
+    *x0 = llroundl(ax + t0 * dx);
+    *y0 = llroundl(ay + t0 * dy);
+    *x1 = llroundl(ax + t1 * dx);
+    *y1 = llroundl(ay + t1 * dy);
+    return 1;
+}
+
+static inline int ssd1306_line_exact(ssd1306_coord_t c)
+{
+    return c >= -SSD1306_LINE_EXACT && c <= SSD1306_LINE_EXACT;
+}
+
+/* Minor axis offset of pixel k of a Bresenham line running n pixels along
+ * its major axis and mn along the minor one */
+static inline ssd1306_coord_t ssd1306_line_minor(ssd1306_coord_t k, ssd1306_coord_t mn, ssd1306_coord_t n)
+{
+    return (2 * k * mn + n - 1) / (2 * n);
+}
+
+/* Draw a line. Horizontal and vertical lines take the byte-mask fast paths.
+ * Others are Bresenham lines whose pixel k is known in closed form, so only
+ * the steps inside the clip rectangle are walked, starting with the error
+ * term the full line would have there. */
+void ssd1306_draw_line_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                ssd1306_coord_t x1, ssd1306_coord_t y1, int color)
+{
+    if (y0 == y1) {
+        ssd1306_fill_box(display, (x0 < x1) ? x0 : x1, y0, (x0 < x1) ? x1 : x0, y0, color);
+        return;
+    }
+    if (x0 == x1) {
+        ssd1306_fill_box(display, x0, (y0 < y1) ? y0 : y1, x0, (y0 < y1) ? y1 : y0, color);
+        return;
+    }
+
+    if (!ssd1306_line_exact(x0) || !ssd1306_line_exact(y0) ||
+        !ssd1306_line_exact(x1) || !ssd1306_line_exact(y1)) {
+        if (!ssd1306_clip_line(display, &x0, &y0, &x1, &y1)) {
+            return;
+        }
+    }
+
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    ssd1306_coord_t dx = (x1 - x0) * sx;
+    ssd1306_coord_t dy = (y1 - y0) * sy;
+    int x_major = dx >= dy;
+    ssd1306_coord_t n = x_major ? dx : dy;
+    ssd1306_coord_t mn = x_major ? dy : dx;
+
+    if (n == 0) {
+        ssd1306_set_pixel_internal(display, x0, y0, color);
+        return;
+    }
+
+    /* Offsets along each axis that land inside the clip rectangle */
+    ssd1306_coord_t lo_x = (sx > 0) ? display->clip_x0 - x0 : x0 - display->clip_x1;
+    ssd1306_coord_t hi_x = (sx > 0) ? display->clip_x1 - x0 : x0 - display->clip_x0;
+    ssd1306_coord_t lo_y = (sy > 0) ? display->clip_y0 - y0 : y0 - display->clip_y1;
+    ssd1306_coord_t hi_y = (sy > 0) ? display->clip_y1 - y0 : y0 - display->clip_y0;
+    ssd1306_coord_t lo_minor = x_major ? lo_y : lo_x;
+    ssd1306_coord_t hi_minor = x_major ? hi_y : hi_x;
+    ssd1306_coord_t first = x_major ? lo_x : lo_y;
+    ssd1306_coord_t last = x_major ? hi_x : hi_y;
+
+    if (first < 0) first = 0;
+    if (last > n) last = n;
+    if (first > last || ssd1306_line_minor(first, mn, n) > hi_minor ||
+        ssd1306_line_minor(last, mn, n) < lo_minor) {
+        return;
+    }
+
+    /* The minor offset grows by at most one per step: bisect for the first
+     * and last steps inside the minor bounds */
+    ssd1306_coord_t lo = first, hi = last;
+    while (lo < hi) {
+        ssd1306_coord_t mid = lo + (hi - lo) / 2;
+        if (ssd1306_line_minor(mid, mn, n) < lo_minor) lo = mid + 1; else hi = mid;
+    }
+    first = lo;
+
+    hi = last;
+    while (lo < hi) {
+        ssd1306_coord_t mid = hi - (hi - lo) / 2;
+        if (ssd1306_line_minor(mid, mn, n) > hi_minor) hi = mid - 1; else lo = mid;
+    }
+    last = hi;
+
+    ssd1306_coord_t num = 2 * first * mn + n - 1;
+    ssd1306_coord_t minor = num / (2 * n);
+    ssd1306_coord_t rem = num % (2 * n);
+
+    for (ssd1306_coord_t k = first; k <= last; k++) {
+        if (x_major) {
+            ssd1306_set_pixel_internal(display, x0 + k * sx, y0 + minor * sy, color);
+        } else {
+            ssd1306_set_pixel_internal(display, x0 + minor * sx, y0 + k * sy, color);
+        }
+
+        rem += 2 * mn;
+        if (rem >= 2 * n) {
+            rem -= 2 * n;
+            minor++;
+        }
+    }
+}
+
+/* Draw a rectangle outline from fast lines, touching each pixel once so
+ * inverse outlines keep their corners */
+void ssd1306_draw_rect_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                ssd1306_coord_t w, ssd1306_coord_t h, int color)
+{
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    ssd1306_coord_t x1 = ssd1306_span_end(x, w);
+    ssd1306_coord_t y1 = ssd1306_span_end(y, h);
+
+    ssd1306_fill_box(display, x, y, x1, y, color);                 /* Top */
+    if (y1 > y) {
+        ssd1306_fill_box(display, x, y1, x1, y1, color);           /* Bottom */
+    }
+    if (y1 - y > 1) {
+        ssd1306_fill_box(display, x, y + 1, x, y1 - 1, color);     /* Left */
+        if (x1 > x) {
+            ssd1306_fill_box(display, x1, y + 1, x1, y1 - 1, color); /* Right */
+        }
+    }
+}
+
+/* Draw a circle outline with Bresenham's algorithm */
+void ssd1306_draw_circle_internal(ssd1306_t *display, ssd1306_coord_t cx, ssd1306_coord_t cy,
+                                  ssd1306_coord_t r, int color)
+{
+    if (r < 0 || r > SSD1306_MAX_RADIUS || ssd1306_clip_rejects(display, cx - r, cy - r, cx + r, cy + r)) {
+        return;
+    }
+
+    int x0 = cx, y0 = cy;
+    int x = 0;
+    int y = r;
+    int d = 3 - 2 * r;
+
+    while (y >= x) {
+        /* Draw 8 octants */
+        ssd1306_set_pixel_internal(display, x0 + x, y0 + y, color);
+        ssd1306_set_pixel_internal(display, x0 - x, y0 + y, color);
+        ssd1306_set_pixel_internal(display, x0 + x, y0 - y, color);
+        ssd1306_set_pixel_internal(display, x0 - x, y0 - y, color);
+        ssd1306_set_pixel_internal(display, x0 + y, y0 + x, color);
+        ssd1306_set_pixel_internal(display, x0 - y, y0 + x, color);
+        ssd1306_set_pixel_internal(display, x0 + y, y0 - x, color);
+        ssd1306_set_pixel_internal(display, x0 - y, y0 - x, color);
+
+        if (d < 0) {
+            d = d + 4 * x + 6;
+        } else {
+            d = d + 4 * (x - y) + 10;
+            y--;
+        }
+        x++;
+    }
+}
+
+/* Half-width of row y of an ellipse with squared radii rx2 and ry2: the
+ * largest x with x^2*ry^2 + y^2*rx^2 <= rx^2*ry^2, walked in from the
+ * half-width x of the row before, so a whole quadrant costs O(rx + ry) */
+static int ssd1306_ellipse_width(int x, int y, int64_t rx2, int64_t ry2)
+{
+    while (x > 0 && (int64_t) x * x * ry2 + (int64_t) y * y * rx2 > rx2 * ry2) {
+        x--;
+    }
+    return x;
+}
+
+/* Whether an ellipse has usable radii and its bounding box meets the clip
+ * rectangle; afterwards its centre is known to fit an int */
+static int ssd1306_ellipse_visible(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                   ssd1306_coord_t rx, ssd1306_coord_t ry)
+{
+    return rx >= 0 && ry >= 0 && rx <= SSD1306_MAX_RADIUS && ry <= SSD1306_MAX_RADIUS &&
+           !ssd1306_clip_rejects(display, x0 - rx, y0 - ry, x0 + rx, y0 + ry);
+}
+
+/* Draw the run from..to either side of x0 on row y, as one span when the
+ * two halves meet */
+static void ssd1306_ellipse_row(ssd1306_t *display, int x0, int y, int from, int to, int color)
+{
+    if (y < display->clip_y0 || y > display->clip_y1) {
+        return;
+    }
+    if (from == 0) {
+        ssd1306_fill_box(display, x0 - to, y, x0 + to, y, color);
+        return;
+    }
+    ssd1306_fill_box(display, x0 - to, y, x0 - from, y, color);
+    ssd1306_fill_box(display, x0 + from, y, x0 + to, y, color);
+}
+
+/* Draw a filled circle as one span per row */
+void ssd1306_fill_circle_internal(ssd1306_t *display, ssd1306_coord_t x0, ssd1306_coord_t y0,
+                                  ssd1306_coord_t r, int color)
+{
+    ssd1306_fill_ellipse_internal(display, x0, y0, r, r, color);
+}
+
+/* Draw an ellipse outline: each row covers the run it adds beyond the next
+ * row out, so steep edges stay connected and no pixel is drawn twice */
+void ssd1306_draw_ellipse_internal(ssd1306_t *display, ssd1306_coord_t cx, ssd1306_coord_t cy,
+                                   ssd1306_coord_t rx, ssd1306_coord_t ry, int color)
+{
+    if (!ssd1306_ellipse_visible(display, cx, cy, rx, ry)) {
+        return;
+    }
+
+    int x0 = cx, y0 = cy;
+    int64_t rx2 = rx * rx;
+    int64_t ry2 = ry * ry;
+    int x = rx;
+
+    for (int y = 0; y <= ry; y++) {
+        int next = (y < ry) ? ssd1306_ellipse_width(x, y + 1, rx2, ry2) : -1;
+        int from = (next + 1 < x) ? next + 1 : x;
+
+        ssd1306_ellipse_row(display, x0, y0 + y, from, x, color);
+        if (y > 0) {
+            ssd1306_ellipse_row(display, x0, y0 - y, from, x, color);
+        }
+        x = next;
+    }
+}
+
+/* Draw a filled ellipse as one span per row */
+void ssd1306_fill_ellipse_internal(ssd1306_t *display, ssd1306_coord_t cx, ssd1306_coord_t cy,
+                                   ssd1306_coord_t rx, ssd1306_coord_t ry, int color)
+{
+    if (!ssd1306_ellipse_visible(display, cx, cy, rx, ry)) {
+        return;
+    }
+
+    int x0 = cx, y0 = cy;
+    int64_t rx2 = rx * rx;
+    int64_t ry2 = ry * ry;
+    int x = rx;
+
+    for (int y = 0; y <= ry; y++) {
+        x = ssd1306_ellipse_width(x, y, rx2, ry2);
+        ssd1306_ellipse_row(display, x0, y0 + y, 0, x, color);
+        if (y > 0) {
+            ssd1306_ellipse_row(display, x0, y0 - y, 0, x, color);
+        }
+    }
+}
+
+/* Draw a filled rectangle with quarter-circle corners of radius r. The
+ * radius is limited so each side keeps a straight pixel; a square of side
+ * 2r + 1 is the filled circle of radius r */
+void ssd1306_fill_round_rect_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                      ssd1306_coord_t w, ssd1306_coord_t h, ssd1306_coord_t r, int color)
+{
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    ssd1306_coord_t x1 = ssd1306_span_end(x, w);
+    ssd1306_coord_t y1 = ssd1306_span_end(y, h);
+
+    if (ssd1306_clip_rejects(display, x, y, x1, y1)) {
+        return;
+    }
+
+    ssd1306_coord_t max_r = (((w < h) ? w : h) - 1) / 2;
+    if (r > max_r) r = max_r;
+    if (r > SSD1306_MAX_RADIUS) r = SSD1306_MAX_RADIUS;
+    if (r < 0) r = 0;
+
+    int64_t r2 = r * r;
+    int hw = r;
+
+    ssd1306_fill_box(display, x, y + r, x1, y1 - r, color);
+
+    for (int dy = 1; dy <= r; dy++) {
+        hw = ssd1306_ellipse_width(hw, dy, r2, r2);
+        ssd1306_fill_box(display, x + r - hw, y + r - dy, x1 - r + hw, y + r - dy, color);
+        ssd1306_fill_box(display, x + r - hw, y1 - r + dy, x1 - r + hw, y1 - r + dy, color);
+    }
+}
+
+/* Print text at the cursor, handling newlines and wrapping */
+void ssd1306_print_internal(ssd1306_t *display, const char *text, size_t text_len)
+{
+    for (size_t i = 0; i < text_len; i++) {
+        char c = text[i];
+        
+        if (c == '\n') {
+            display->cursor_y += 8 * display->text_size;
+            display->cursor_x = 0;
+            continue;
+        }
+        
+        if (c == '\r') {
+            display->cursor_x = 0;
+            continue;
+        }
+        
+        /* Handle character wrapping */
+        if (display->wrap && (display->cursor_x + 6 * display->text_size > ssd1306_logical_width(display))) {
+            display->cursor_x = 0;
+            display->cursor_y += 8 * display->text_size;
+        }
+        
+        /* Skip if we're past the bottom */
+        if (display->cursor_y >= ssd1306_logical_height(display)) {
+            break;
+        }
+        
+        /* Draw character */
+        ssd1306_draw_char_internal(display, display->cursor_x, display->cursor_y, c, 
+                                  display->text_color, display->text_bg_color, display->text_size);
+        
+        display->cursor_x += 6 * display->text_size;
+    }
+}
+
+/* Bit-expansion tables for scaled text: entry v of table size - 2 is font
+ * column v with every bit repeated size times */
+static uint32_t ssd1306_glyph_expand[3][256];
+static pthread_once_t ssd1306_glyph_expand_once = PTHREAD_ONCE_INIT;
+
+static void ssd1306_glyph_expand_init(void)
+{
+    for (int size = 2; size <= 4; size++) {
+        for (int v = 0; v < 256; v++) {
+            uint32_t bits = 0;
+            for (int j = 0; j < 8; j++) {
+                if (v & (1 << j)) bits |= ((1u << size) - 1) << (j * size);
+            }
+            ssd1306_glyph_expand[size - 2][v] = bits;
+        }
+    }
+}
+
+/* A font column scaled to 8 * size rows (size <= 8), top row in bit 0 */
+static uint64_t ssd1306_glyph_column(unsigned char line, int size)
+{
+    if (size == 1) {
+        return line;
+    }
+    if (size <= 4) {
+        return ssd1306_glyph_expand[size - 2][line];
+    }
+
+    uint64_t bits = 0;
+    for (int j = 0; j < 8; j++) {
+        if (line & (1 << j)) bits |= ((UINT64_C(1) << size) - 1) << (j * size);
+    }
+    return bits;
+}
+
+/* Apply a bit mask to one buffer byte in the given color */
+static inline void ssd1306_apply_mask(unsigned char *p, unsigned char mask, int color)
+{
+    switch (color) {
+        case SSD1306_WHITE:   *p |= mask;  break;
+        case SSD1306_BLACK:   *p &= ~mask; break;
+        case SSD1306_INVERSE: *p ^= mask;  break;
+    }
+}
+
+/* Write display RAM rows top .. bottom of column x from a bit column whose
+ * bit 0 is row y, touching only rows whose bit is set in area: set bits in
+ * color, clear ones in bg when draw_bg. A column that covers whole pages in
+ * white on black (or black on white) is a plain byte store; otherwise each
+ * page gets the slice shifted into place. */
+static void ssd1306_write_rows(ssd1306_t *display, int x, int y, uint64_t bits, uint64_t area,
+                               int top, int bottom, int color, int bg, int draw_bg)
+{
+    for (int page = top / 8; page <= bottom / 8; page++) {
+        int pos = page * 8 - y;
+        unsigned char fg = (pos >= 0) ? bits >> pos : bits << -pos;
+        unsigned char mask = (pos >= 0) ? area >> pos : area << -pos;
+        unsigned char *p = display->buffer + page * display->width + x;
+
+        if (page * 8 < top) mask &= 0xFF << (top & 7);
+        if (page * 8 + 7 > bottom) mask &= 0xFF >> (7 - (bottom & 7));
+
+        if (draw_bg && mask == 0xFF && color == SSD1306_WHITE && bg == SSD1306_BLACK) {
+            *p = fg;
+        } else if (draw_bg && mask == 0xFF && color == SSD1306_BLACK && bg == SSD1306_WHITE) {
+            *p = ~fg;
+        } else {
+            ssd1306_apply_mask(p, fg & mask, color);
+            if (draw_bg) {
+                ssd1306_apply_mask(p, ~fg & mask, bg);
+            }
+        }
+    }
+}
+
+/* Write rows top .. bottom of panel column x as ssd1306_write_rows() does,
+ * moving each run of rows to where the start line shows it. The caller
+ * clips x and top .. bottom. */
+static void ssd1306_write_column(ssd1306_t *display, int x, int y, uint64_t bits, uint64_t area,
+                                 int top, int bottom, int color, int bg, int draw_bg)
+{
+    int ram, n;
+
+    if (!display->start_line) {
+        ssd1306_write_rows(display, x, y, bits, area, top, bottom, color, bg, draw_bg);
+        return;
+    }
+
+    for (; top <= bottom; top += n) {
+        n = ssd1306_ram_run(display, top, bottom, &ram);
+        ssd1306_write_rows(display, x, y + (ram - top), bits, area, ram, ram + n - 1, color, bg, draw_bg);
+    }
+}
+
+/* Draw a 5x7 glyph. Font columns are already in the panel's vertical byte
+ * order, so each column is written as whole bytes (shifted across two pages
+ * when y is not page aligned), scaled through the expansion tables. On a
+ * quarter-turned panel the font becomes a page format bitmap, or a box per
+ * font pixel when scaled. */
+void ssd1306_draw_char_internal(ssd1306_t *display, int x, int y, char c, int color, int bg, int size)
+{
+    ssd1306_coord_t x1 = (ssd1306_coord_t) x + 5 * (ssd1306_coord_t) size - 1;
+    ssd1306_coord_t y1 = (ssd1306_coord_t) y + 8 * (ssd1306_coord_t) size - 1;
+
+    /* Glyphs wholly outside the clip rectangle cost nothing */
+    if (size < 1 || ssd1306_clip_rejects(display, x, y, x1, y1)) {
+        return;
+    }
+
+    if (c < 32 || c > 126) c = 32; /* Replace non-printable with space */
+    
+    int char_index = c - 32;
+    if (char_index >= sizeof(font5x7) / sizeof(font5x7[0])) {
+        char_index = 0; /* Default to space */
+    }
+
+    int draw_bg = (bg != color);
+
+    if (size == 1 && (display->rotation & 1)) {
+        ssd1306_draw_bitmap_internal(display, x, y, font5x7[char_index], NULL, 5, 8, SSD1306_FORMAT_PAGE,
+                                     color, draw_bg ? bg : -1);
+        return;
+    }
+
+    if (size > 8 || (display->rotation & 1)) {
+        /* Too tall for one bit column, or across the panel's columns: fill
+         * each scaled font pixel */
+        for (int i = 0; i < 5; i++) {
+            unsigned char line = font5x7[char_index][i];
+            for (int j = 0; j < 8; j++) {
+                int on = line & (1 << j);
+                if (on || draw_bg) {
+                    ssd1306_coord_t px = x + (ssd1306_coord_t) i * size;
+                    ssd1306_coord_t py = y + (ssd1306_coord_t) j * size;
+                    ssd1306_fill_box(display, px, py, px + size - 1, py + size - 1, on ? color : bg);
+                }
+            }
+        }
+        return;
+    }
+
+    if (size > 1) {
+        pthread_once(&ssd1306_glyph_expand_once, ssd1306_glyph_expand_init);
+    }
+
+    int top = (y > display->clip_y0) ? y : display->clip_y0;
+    int bottom = (y1 < display->clip_y1) ? y1 : display->clip_y1;
+
+    for (int i = 0; i < 5; i++) {
+        uint64_t bits = ssd1306_glyph_column(font5x7[char_index][i], size);
+
+        for (int a = 0; a < size; a++) {
+            int px = x + i * size + a;
+            if (px >= display->clip_x0 && px <= display->clip_x1) {
+                ssd1306_write_column(display, px, y, bits, ~UINT64_C(0), top, bottom, color, bg, draw_bg);
+            }
+        }
+    }
+
+    ssd1306_mark_box(display,
+                     (x > display->clip_x0) ? x : display->clip_x0,
+                     top,
+                     (x1 < display->clip_x1) ? x1 : display->clip_x1,
+                     bottom);
+}
+
+/* Framebuffer import and export */
+
+/* Transpose an 8x8 bit matrix held in a word: bit 8r + c moves to 8c + r */
+static inline uint64_t ssd1306_transpose8(uint64_t x)
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & UINT64_C(0x00AA00AA00AA00AA);
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & UINT64_C(0x0000CCCC0000CCCC);
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & UINT64_C(0x00000000F0F0F0F0);
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/* Bit of a packed row byte holding column c of its 8-pixel group */
+static inline int ssd1306_row_bit(int format, int c)
+{
+    return (format == SSD1306_FORMAT_XBM) ? c : 7 - c;
+}
+
+/* Size in bytes of a w x h image in a given format, 0 if unknown. Page
+ * format pads the last page and packed rows the last byte of each row. */
+size_t ssd1306_bitmap_size(int format, int w, int h)
+{
+    switch (format) {
+        case SSD1306_FORMAT_PAGE:
+            return (size_t) w * ((h + 7) / 8);
+        case SSD1306_FORMAT_ROW:
+        case SSD1306_FORMAT_XBM:
+            return (size_t) ((w + 7) / 8) * h;
+        case SSD1306_FORMAT_BYTE:
+            return (size_t) w * h;
+    }
+    return 0;
+}
+
+/* Size in bytes of the framebuffer in a given format, 0 if unknown */
+size_t ssd1306_buffer_format_size(ssd1306_t *display, int format)
+{
+    return ssd1306_bitmap_size(format, display->width, display->height);
+}
+
+/* Copy the framebuffer into out, converting it to the given format. Packed
+ * rows are produced a page-native 8x8 block at a time by bit transposition. */
+void ssd1306_export_buffer(ssd1306_t *display, int format, unsigned char *out)
+{
+    int stride = display->width / 8;
+
+    switch (format) {
+        case SSD1306_FORMAT_PAGE:
+            memcpy(out, display->buffer, display->buffer_size);
+            break;
+
+        case SSD1306_FORMAT_ROW:
+        case SSD1306_FORMAT_XBM:
+            for (int page = 0; page < display->pages; page++) {
+                for (int group = 0; group < stride; group++) {
+                    const unsigned char *col = display->buffer + page * display->width + group * 8;
+                    uint64_t block = 0;
+
+                    for (int c = 0; c < 8; c++) {
+                        block |= (uint64_t) col[c] << (8 * ssd1306_row_bit(format, c));
+                    }
+                    block = ssd1306_transpose8(block);
+                    for (int j = 0; j < 8; j++) {
+                        out[(page * 8 + j) * stride + group] = block >> (8 * j);
+                    }
+                }
+            }
+            break;
+
+        case SSD1306_FORMAT_BYTE:
+            for (int y = 0; y < display->height; y++) {
+                const unsigned char *col = display->buffer + (y / 8) * display->width;
+                for (int x = 0; x < display->width; x++) {
+                    *out++ = (col[x] >> (y & 7)) & 1;
+                }
+            }
+            break;
+    }
+}
+
+/* Mark units first..last of a format as dirty, where a line of the format
+ * holds per_line units of unit_px pixels each and is line_px rows tall */
+static void ssd1306_mark_units(ssd1306_t *display, size_t first, size_t last, size_t per_line,
+                               int unit_px, int line_px)
+{
+    size_t line0 = first / per_line;
+    size_t line1 = last / per_line;
+    int x0 = 0, x1 = display->width - 1;
+
+    if (line0 == line1) {
+        x0 = (first % per_line) * unit_px;
+        x1 = (last % per_line) * unit_px + unit_px - 1;
+    }
+    ssd1306_mark_dirty(display, x0, line0 * line_px, x1, line1 * line_px + line_px - 1);
+}
+
+/* Write len bytes of frame data in the given format, starting offset bytes
+ * into that format's layout. Clip rectangle and colors do not apply. Whole
+ * 8x8 blocks of packed rows are transposed in one step, partial ones bit by
+ * bit. Returns -1 if the data does not fit. */
+int ssd1306_import_buffer(ssd1306_t *display, int format, const unsigned char *data, size_t len, size_t offset)
+{
+    size_t size = ssd1306_buffer_format_size(display, format);
+    size_t end = offset + len;
+    int stride = display->width / 8;
+
+    if (!size || offset > size || len > size - offset) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    switch (format) {
+        case SSD1306_FORMAT_PAGE:
+            memcpy(display->buffer + offset, data, len);
+            ssd1306_mark_units(display, offset, end - 1, display->width, 1, 8);
+            break;
+
+        case SSD1306_FORMAT_ROW:
+        case SSD1306_FORMAT_XBM:
+            for (int page = (offset / stride) / 8, last = ((end - 1) / stride) / 8; page <= last; page++) {
+                for (int group = 0; group < stride; group++) {
+                    unsigned char *col = display->buffer + page * display->width + group * 8;
+                    size_t top = (size_t) page * 8 * stride + group;
+                    size_t bottom = top + 7 * stride;
+
+                    if (bottom < offset || top >= end) {
+                        continue;
+                    }
+
+                    if (top >= offset && bottom < end) {
+                        uint64_t block = 0;
+
+                        for (int j = 0; j < 8; j++) {
+                            block |= (uint64_t) data[top + j * stride - offset] << (8 * j);
+                        }
+                        block = ssd1306_transpose8(block);
+                        for (int c = 0; c < 8; c++) {
+                            col[c] = block >> (8 * ssd1306_row_bit(format, c));
+                        }
+                        continue;
+                    }
+
+                    for (int j = 0; j < 8; j++) {
+                        size_t index = top + j * stride;
+                        if (index < offset || index >= end) {
+                            continue;
+                        }
+                        for (int c = 0; c < 8; c++) {
+                            if ((data[index - offset] >> ssd1306_row_bit(format, c)) & 1) {
+                                col[c] |= 1 << j;
+                            } else {
+                                col[c] &= ~(1 << j);
+                            }
+                        }
+                    }
+                }
+            }
+            ssd1306_mark_units(display, offset, end - 1, stride, 8, 1);
+            break;
+
+        case SSD1306_FORMAT_BYTE:
+            for (size_t i = offset; i < end; i++) {
+                int x = i % display->width;
+                int y = i / display->width;
+                unsigned char *p = display->buffer + (y / 8) * display->width + x;
+
+                if (data[i - offset]) {
+                    *p |= 1 << (y & 7);
+                } else {
+                    *p &= ~(1 << (y & 7));
+                }
+            }
+            ssd1306_mark_units(display, offset, end - 1, display->width, 1, 1);
+            break;
+    }
+
+    return 0;
+}
+
+/* Bitmaps */
+
+/* Gather source columns 8g .. 8g + 7 of a bitmap as bit columns holding rows
+ * sy0 .. sy1, row sy0 in bit 0. Packed rows become columns an 8x8 block at a
+ * time through the transpose; rows past sy1 may leave stray high bits. */
+static void ssd1306_bitmap_columns(const unsigned char *data, int format, int w, int g,
+                                   int sy0, int sy1, uint64_t cols[8])
+{
+    memset(cols, 0, 8 * sizeof(cols[0]));
+
+    switch (format) {
+        case SSD1306_FORMAT_PAGE:
+            for (int c = 0; c < 8 && g * 8 + c < w; c++) {
+                for (int page = sy0 / 8; page <= sy1 / 8; page++) {
+                    uint64_t byte = data[(size_t) page * w + g * 8 + c];
+                    int shift = page * 8 - sy0;
+                    cols[c] |= (shift >= 0) ? byte << shift : byte >> -shift;
+                }
+            }
+            break;
+
+        case SSD1306_FORMAT_ROW:
+        case SSD1306_FORMAT_XBM: {
+            size_t stride = (w + 7) / 8;
+
+            for (int band = sy0 / 8; band <= sy1 / 8; band++) {
+                int shift = band * 8 - sy0;
+                uint64_t block = 0;
+
+                for (int j = 0; j < 8; j++) {
+                    int r = band * 8 + j;
+                    if (r >= sy0 && r <= sy1) {
+                        block |= (uint64_t) data[r * stride + g] << (8 * j);
+                    }
+                }
+                if (!block) {
+                    continue;
+                }
+                block = ssd1306_transpose8(block);
+                for (int c = 0; c < 8; c++) {
+                    uint64_t byte = (block >> (8 * ssd1306_row_bit(format, c))) & 0xFF;
+                    cols[c] |= (shift >= 0) ? byte << shift : byte >> -shift;
+                }
+            }
+            break;
+        }
+
+        case SSD1306_FORMAT_BYTE:
+            for (int c = 0; c < 8 && g * 8 + c < w; c++) {
+                for (int r = sy0; r <= sy1; r++) {
+                    if (data[(size_t) r * w + g * 8 + c]) {
+                        cols[c] |= UINT64_C(1) << (r - sy0);
+                    }
+                }
+            }
+            break;
+    }
+}
+
+/* Reverse the bits of a byte */
+static inline unsigned char ssd1306_reverse8(unsigned char b)
+{
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+    return b;
+}
+
+/* Gather row r of a bitmap as a bit row holding columns sx0 .. sx1, column
+ * sx0 in bit 0. On a quarter-turned panel bitmap rows run down the panel's
+ * columns, so packed rows are used a byte at a time without transposing. */
+static uint64_t ssd1306_bitmap_row(const unsigned char *data, int format, int w, int r, int sx0, int sx1)
+{
+    uint64_t bits = 0;
+
+    switch (format) {
+        case SSD1306_FORMAT_PAGE:
+            for (int i = sx0; i <= sx1; i++) {
+                if ((data[(size_t) (r / 8) * w + i] >> (r & 7)) & 1) {
+                    bits |= UINT64_C(1) << (i - sx0);
+                }
+            }
+            break;
+
+        case SSD1306_FORMAT_ROW:
+        case SSD1306_FORMAT_XBM: {
+            const unsigned char *line = data + (size_t) r * ((w + 7) / 8);
+
+            for (int b = sx0 / 8; b <= sx1 / 8; b++) {
+                uint64_t byte = (format == SSD1306_FORMAT_XBM) ? line[b] : ssd1306_reverse8(line[b]);
+                int shift = b * 8 - sx0;
+                bits |= (shift >= 0) ? byte << shift : byte >> -shift;
+            }
+            break;
+        }
+
+        case SSD1306_FORMAT_BYTE:
+            for (int i = sx0; i <= sx1; i++) {
+                if (data[(size_t) r * w + i]) {
+                    bits |= UINT64_C(1) << (i - sx0);
+                }
+            }
+            break;
+    }
+
+    return bits;
+}
+
+/* Draw a w x h bitmap with its top left corner at (x, y): set bits in color
+ * and, unless bg is -1, clear ones in bg. With a mask (same format and size
+ * as data) only pixels whose mask bit is set are touched. Only the part
+ * inside the clip rectangle is converted, as bit columns of at most 64 rows
+ * written through the glyph column writer, so page-aligned white on black
+ * rows become plain byte stores; on a quarter-turned panel bitmap rows are
+ * the columns. data holds ssd1306_bitmap_size() bytes. */
+void ssd1306_draw_bitmap_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                  const unsigned char *data, const unsigned char *mask,
+                                  int w, int h, int format, int color, int bg)
+{
+    if (w <= 0 || h <= 0 || !ssd1306_bitmap_size(format, w, h)) {
+        return;
+    }
+
+    ssd1306_coord_t x1 = ssd1306_span_end(x, w);
+    ssd1306_coord_t y1 = ssd1306_span_end(y, h);
+
+    if (ssd1306_clip_rejects(display, x, y, x1, y1)) {
+        return;
+    }
+
+    /* Visible part in bitmap coordinates; at most 64 pixels along the
+     * panel's columns */
+    int sx0 = (x < display->clip_x0) ? display->clip_x0 - x : 0;
+    int sy0 = (y < display->clip_y0) ? display->clip_y0 - y : 0;
+    int sx1 = (x1 > display->clip_x1) ? display->clip_x1 - x : w - 1;
+    int sy1 = (y1 > display->clip_y1) ? display->clip_y1 - y : h - 1;
+    uint64_t fg[8], keep[8];
+
+    if (display->rotation & 1) {
+        /* Row r lands on panel column width - 1 - (y + r), rows x + sx0 on */
+        for (int r = sy0; r <= sy1; r++) {
+            uint64_t bits = ssd1306_bitmap_row(data, format, w, r, sx0, sx1);
+            uint64_t area = mask ? ssd1306_bitmap_row(mask, format, w, r, sx0, sx1) : ~UINT64_C(0);
+
+            ssd1306_write_column(display, display->width - 1 - (y + r), x + sx0, bits, area,
+                                 x + sx0, x + sx1, color, bg, bg >= 0);
+        }
+        ssd1306_mark_box(display, x + sx0, y + sy0, x + sx1, y + sy1);
+        return;
+    }
+
+    for (int g = sx0 / 8; g <= sx1 / 8; g++) {
+        ssd1306_bitmap_columns(data, format, w, g, sy0, sy1, fg);
+        if (mask) {
+            ssd1306_bitmap_columns(mask, format, w, g, sy0, sy1, keep);
+        }
+
+        for (int c = 0; c < 8; c++) {
+            int i = g * 8 + c;
+            if (i < sx0 || i > sx1) {
+                continue;
+            }
+            ssd1306_write_column(display, x + i, y + sy0, fg[c], mask ? keep[c] : ~UINT64_C(0),
+                                 y + sy0, y + sy1, color, bg, bg >= 0);
+        }
+    }
+
+    ssd1306_mark_box(display, x + sx0, y + sy0, x + sx1, y + sy1);
+}
+
+/* Region moves */
+
+/* Bits 0 .. n-1 of a column word */
+static inline uint64_t ssd1306_rows_mask(int n)
+{
+    return (n >= 64) ? ~UINT64_C(0) : (UINT64_C(1) << n) - 1;
+}
+
+/* Panel column x as one word, bit y for row y */
+static inline uint64_t ssd1306_column_load(ssd1306_t *display, int x)
+{
+    uint64_t col = 0;
+
+    for (int page = 0; page < display->pages; page++) {
+        col |= (uint64_t) display->buffer[page * display->width + x] << (8 * page);
+    }
+    return col;
+}
+
+/* Store rows top .. bottom of panel column x from a column word */
+static inline void ssd1306_column_store(ssd1306_t *display, int x, uint64_t col, int top, int bottom)
+{
+    uint64_t mask = ssd1306_rows_mask(bottom - top + 1) << top;
+
+    for (int page = top / 8; page <= bottom / 8; page++) {
+        unsigned char *p = display->buffer + page * display->width + x;
+        unsigned char m = mask >> (8 * page);
+
+        *p = (*p & ~m) | ((col >> (8 * page)) & m);
+    }
+}
+
+/* Move the panel box x0..x1, y0..y1 by (dx, dy); the box and its
+ * destination lie on the panel. Whole pages moved by whole pages are a
+ * memmove per page row. Anything else is a column at a time: the column is
+ * loaded as one word, shifted by dy and stored under a mask. Columns (and
+ * page rows) are taken in the order that reads each one before the move
+ * overwrites it, so overlapping boxes are safe. */
+static void ssd1306_move_panel_box(ssd1306_t *display, int x0, int y0, int x1, int y1, int dx, int dy)
+{
+    int w = x1 - x0 + 1;
+
+    if ((dy & 7) == 0 && (y0 & 7) == 0 && (y1 & 7) == 7) {
+        int page0 = y0 / 8, page1 = y1 / 8, shift = dy / 8;
+        int step = (shift > 0) ? -1 : 1;
+
+        for (int page = (shift > 0) ? page1 : page0, n = page1 - page0 + 1; n > 0; page += step, n--) {
+            memmove(display->buffer + (page + shift) * display->width + x0 + dx,
+                    display->buffer + page * display->width + x0, w);
+        }
+    } else {
+        uint64_t rows = ssd1306_rows_mask(y1 - y0 + 1) << y0;
+        int step = (dx > 0) ? -1 : 1;
+
+        for (int x = (dx > 0) ? x1 : x0, n = w; n > 0; x += step, n--) {
+            uint64_t col = ssd1306_column_load(display, x) & rows;
+
+            col = (dy >= 0) ? col << dy : col >> -dy;
+            ssd1306_column_store(display, x + dx, col, y0 + dy, y1 + dy);
+        }
+    }
+
+    ssd1306_mark_dirty(display, x0 + dx, y0 + dy, x1 + dx, y1 + dy);
+}
+
+/* Move the box x0..x1, y0..y1 given in drawing coordinates by (dx, dy).
+ * The caller clips the box so that it and its destination are visible. */
+static void ssd1306_move_box(ssd1306_t *display, int x0, int y0, int x1, int y1, int dx, int dy)
+{
+    if (display->start_line) {
+        /* Rows the start line wraps: pixel by pixel, in the same
+         * overlap-safe order */
+        int xstep = (dx > 0) ? -1 : 1, ystep = (dy > 0) ? -1 : 1;
+
+        for (int y = (dy > 0) ? y1 : y0, i = y1 - y0; i >= 0; y += ystep, i--) {
+            for (int x = (dx > 0) ? x1 : x0, j = x1 - x0; j >= 0; x += xstep, j--) {
+                ssd1306_set_pixel_internal(display, x + dx, y + dy, ssd1306_get_pixel_internal(display, x, y));
+            }
+        }
+        return;
+    }
+
+    if (display->rotation & 1) {
+        ssd1306_move_panel_box(display, display->width - 1 - y1, x0, display->width - 1 - y0, x1, -dy, dx);
+    } else {
+        ssd1306_move_panel_box(display, x0, y0, x1, y1, dx, dy);
+    }
+}
+
+/* Distance from one coordinate to another, when it is shorter than limit
+ * either way (otherwise nothing visible can move that far) */
+static int ssd1306_move_distance(ssd1306_coord_t from, ssd1306_coord_t to, int limit, int *distance)
+{
+    /* Coordinates of opposite sign could overflow the subtraction */
+    if ((from < 0) != (to < 0) && (to < 0 ? to <= from - limit : to >= from + limit)) {
+        return -1;
+    }
+
+    ssd1306_coord_t d = to - from;
+    if (d <= -limit || d >= limit) {
+        return -1;
+    }
+
+    *distance = (int) d;
+    return 0;
+}
+
+/* Copy the w x h pixels at (sx, sy) to (dx, dy). Source pixels off the
+ * panel are not copied and destination pixels outside the clip rectangle
+ * are left alone; the areas may overlap. */
+void ssd1306_copy_rect_internal(ssd1306_t *display, ssd1306_coord_t sx, ssd1306_coord_t sy,
+                                ssd1306_coord_t w, ssd1306_coord_t h, ssd1306_coord_t dx, ssd1306_coord_t dy)
+{
+    int ox, oy;
+
+    if (w <= 0 || h <= 0 ||
+        ssd1306_move_distance(sx, dx, ssd1306_logical_width(display), &ox) != 0 ||
+        ssd1306_move_distance(sy, dy, ssd1306_logical_height(display), &oy) != 0) {
+        return;
+    }
+
+    /* Source pixels on the panel whose destination lies in the clip
+     * rectangle */
+    ssd1306_coord_t x0 = sx, y0 = sy;
+    ssd1306_coord_t x1 = ssd1306_span_end(sx, w), y1 = ssd1306_span_end(sy, h);
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= ssd1306_logical_width(display)) x1 = ssd1306_logical_width(display) - 1;
+    if (y1 >= ssd1306_logical_height(display)) y1 = ssd1306_logical_height(display) - 1;
+    if (x0 < display->clip_x0 - ox) x0 = display->clip_x0 - ox;
+    if (y0 < display->clip_y0 - oy) y0 = display->clip_y0 - oy;
+    if (x1 > display->clip_x1 - ox) x1 = display->clip_x1 - ox;
+    if (y1 > display->clip_y1 - oy) y1 = display->clip_y1 - oy;
+    if (x1 < x0 || y1 < y0) {
+        return;
+    }
+
+    ssd1306_move_box(display, x0, y0, x1, y1, ox, oy);
+}
+
+/* Scroll the contents of the w x h region at (x, y) by (dx, dy) within the
+ * region, clipped to the clip rectangle. Pixels moved out of the region
+ * are dropped and the ones left vacated are set to fill, or kept when fill
+ * is negative. */
+void ssd1306_scroll_region_internal(ssd1306_t *display, ssd1306_coord_t x, ssd1306_coord_t y,
+                                    ssd1306_coord_t w, ssd1306_coord_t h, ssd1306_coord_t dx, ssd1306_coord_t dy,
+                                    int fill)
+{
+    int lw = ssd1306_logical_width(display), lh = ssd1306_logical_height(display);
+
+    if (w <= 0 || h <= 0 || ssd1306_clip_rejects(display, x, y, ssd1306_span_end(x, w), ssd1306_span_end(y, h))) {
+        return;
+    }
+
+    /* The region within the clip rectangle */
+    int rx0 = (x > display->clip_x0) ? x : display->clip_x0;
+    int ry0 = (y > display->clip_y0) ? y : display->clip_y0;
+    int rx1 = (ssd1306_span_end(x, w) < display->clip_x1) ? ssd1306_span_end(x, w) : display->clip_x1;
+    int ry1 = (ssd1306_span_end(y, h) < display->clip_y1) ? ssd1306_span_end(y, h) : display->clip_y1;
+
+    /* Moving the whole panel size or more only empties the region */
+    int ox = (dx < -lw) ? -lw : (dx > lw) ? lw : dx;
+    int oy = (dy < -lh) ? -lh : (dy > lh) ? lh : dy;
+
+    if (ox == 0 && oy == 0) {
+        return;
+    }
+
+    /* Pixels that stay in the region */
+    int x0 = (ox > 0) ? rx0 : rx0 - ox, x1 = (ox > 0) ? rx1 - ox : rx1;
+    int y0 = (oy > 0) ? ry0 : ry0 - oy, y1 = (oy > 0) ? ry1 - oy : ry1;
+
+    if (x0 <= x1 && y0 <= y1) {
+        ssd1306_move_box(display, x0, y0, x1, y1, ox, oy);
+    }
+
+    if (fill < 0) {
+        return;
+    }
+
+    /* Rows left by the vertical move, then columns left by the horizontal
+     * one in the other rows, so no pixel is filled twice */
+    if (oy > 0) {
+        ssd1306_fill_box(display, rx0, ry0, rx1, (ry0 + oy - 1 < ry1) ? ry0 + oy - 1 : ry1, fill);
+        ry0 += oy;
+    } else if (oy < 0) {
+        ssd1306_fill_box(display, rx0, (ry1 + oy + 1 > ry0) ? ry1 + oy + 1 : ry0, rx1, ry1, fill);
+        ry1 += oy;
+    }
+
+    if (ry0 > ry1) {
+        return;
+    }
+
+    if (ox > 0) {
+        ssd1306_fill_box(display, rx0, ry0, (rx0 + ox - 1 < rx1) ? rx0 + ox - 1 : rx1, ry1, fill);
+    } else if (ox < 0) {
+        ssd1306_fill_box(display, (rx1 + ox + 1 > rx0) ? rx1 + ox + 1 : rx0, ry0, rx1, ry1, fill);
+    }
+}
+
+/* Draw batches */
+
+/* Text coordinates are kept in the int cursor */
+static inline int ssd1306_cursor_fits(ssd1306_coord_t x, ssd1306_coord_t y)
+{
+    return x >= INT_MIN && x <= INT_MAX && y >= INT_MIN && y <= INT_MAX;
+}
+
+/* Draw one decoded batch primitive. Returns NULL, or why it was not drawn. */
+const char *ssd1306_draw_op_internal(ssd1306_t *display, const ssd1306_draw_op_t *op)
+{
+    const ssd1306_coord_t *a = op->arg;
+
+    switch (op->op) {
+        case SSD1306_DRAW_PIXEL:
+            ssd1306_set_pixel_internal(display, a[0], a[1], a[2]);
+            return NULL;
+
+        case SSD1306_DRAW_LINE:
+            ssd1306_draw_line_internal(display, a[0], a[1], a[2], a[3], a[4]);
+            return NULL;
+
+        case SSD1306_DRAW_HLINE:
+            ssd1306_draw_fast_hline_internal(display, a[0], a[1], a[2], a[3]);
+            return NULL;
+
+        case SSD1306_DRAW_VLINE:
+            ssd1306_draw_fast_vline_internal(display, a[0], a[1], a[2], a[3]);
+            return NULL;
+
+        case SSD1306_DRAW_RECT:
+            ssd1306_draw_rect_internal(display, a[0], a[1], a[2], a[3], a[4]);
+            return NULL;
+
+        case SSD1306_DRAW_FILL_RECT:
+            ssd1306_fill_rect_internal(display, a[0], a[1], a[2], a[3], a[4]);
+            return NULL;
+
+        case SSD1306_DRAW_CIRCLE:
+            ssd1306_draw_circle_internal(display, a[0], a[1], a[2], a[3]);
+            return NULL;
+
+        case SSD1306_DRAW_FILL_CIRCLE:
+            ssd1306_fill_circle_internal(display, a[0], a[1], a[2], a[3]);
+            return NULL;
+
+        case SSD1306_DRAW_CHAR: {
+            /* Background defaults to the text color, which leaves it untouched */
+            ssd1306_coord_t bg = (op->argc > 3) ? a[3] : a[2];
+            ssd1306_coord_t size = (op->argc > 4) ? a[4] : 1;
+
+            if (!ssd1306_cursor_fits(a[0], a[1])) {
+                return "Coordinates out of range";
+            }
+            if (op->data_len < 1) {
+                return "Empty character";
+            }
+            if (size < 1 || size > 255) {
+                return "Text size out of range";
+            }
+            ssd1306_draw_char_internal(display, a[0], a[1], op->data[0], a[2], bg, size);
+            return NULL;
+        }
+
+        case SSD1306_DRAW_TEXT:
+            if (!ssd1306_cursor_fits(a[0], a[1])) {
+                return "Coordinates out of range";
+            }
+            display->cursor_x = a[0];
+            display->cursor_y = a[1];
+            ssd1306_print_internal(display, (const char *) op->data, op->data_len);
+            return NULL;
+
+        case SSD1306_DRAW_BITMAP: {
+            ssd1306_coord_t bg = (op->argc > 5) ? a[5] : -1;
+            ssd1306_coord_t format = (op->argc > 6) ? a[6] : SSD1306_FORMAT_ROW;
+            size_t size;
+
+            if (format < 0 || format > SSD1306_FORMAT_BYTE) {
+                return "Unknown bitmap format";
+            }
+            if (a[2] <= 0 || a[3] <= 0) {
+                return NULL;
+            }
+            if (a[2] > SSD1306_MAX_BITMAP || a[3] > SSD1306_MAX_BITMAP) {
+                return "Bitmap too large";
+            }
+            size = ssd1306_bitmap_size(format, a[2], a[3]);
+            if (op->data_len < size || (op->mask && op->mask_len < size)) {
+                return "Bitmap data too short";
+            }
+            ssd1306_draw_bitmap_internal(display, a[0], a[1], op->data, op->mask, a[2], a[3], format, a[4],
+                                         (bg >= 0 && bg <= SSD1306_INVERSE) ? bg : -1);
+            return NULL;
+        }
+    }
+
+    return "Unknown primitive";
+}
+
+/* Little-endian 16-bit words following each opcode of a packed batch */
+static const unsigned char ssd1306_packed_words[] = {
+    [SSD1306_DRAW_PIXEL]       = 3,
+    [SSD1306_DRAW_LINE]        = 5,
+    [SSD1306_DRAW_HLINE]       = 4,
+    [SSD1306_DRAW_VLINE]       = 4,
+    [SSD1306_DRAW_RECT]        = 5,
+    [SSD1306_DRAW_FILL_RECT]   = 5,
+    [SSD1306_DRAW_CIRCLE]      = 4,
+    [SSD1306_DRAW_FILL_CIRCLE] = 4,
+    [SSD1306_DRAW_CHAR]        = 5,     /* x, y, color, bg, size; then the character */
+    [SSD1306_DRAW_TEXT]        = 3,     /* x, y, length; then the text */
+    [SSD1306_DRAW_BITMAP]      = 8,     /* x, y, w, h, color, bg, format, masked; then data and mask */
+};
+
+/* Decode and draw a packed batch: per primitive one opcode byte, its signed
+ * 16-bit arguments and any payload bytes. Primitives that cannot be drawn
+ * are passed to error; an unknown opcode or a truncated primitive also ends
+ * the batch, since the rest cannot be located. Returns the number of
+ * primitives decoded. */
+size_t ssd1306_draw_packed_internal(ssd1306_t *display, const unsigned char *ops, size_t len,
+                                    ssd1306_draw_error_t error, void *ctx)
+{
+    size_t pos = 0, index = 0;
+
+    while (pos < len) {
+        ssd1306_draw_op_t op = {0};
+        size_t payload = 0;
+        const char *message;
+        int words, masked = 0;
+
+        op.op = ops[pos++];
+        if (op.op < SSD1306_DRAW_PIXEL || op.op > SSD1306_DRAW_BITMAP) {
+            if (error) error(ctx, index, "Unknown primitive");
+            break;
+        }
+
+        words = ssd1306_packed_words[op.op];
+        if (len - pos < 2 * (size_t) words) {
+            if (error) error(ctx, index, "Truncated primitive");
+            break;
+        }
+        for (int i = 0; i < words; i++, pos += 2) {
+            op.arg[i] = (int16_t) (ops[pos] | ops[pos + 1] << 8);
+        }
+        op.argc = words;
+
+        switch (op.op) {
+            case SSD1306_DRAW_CHAR:
+                payload = 1;
+                break;
+
+            case SSD1306_DRAW_TEXT:
+                op.argc = 2;
+                payload = (uint16_t) op.arg[2];
+                break;
+
+            case SSD1306_DRAW_BITMAP:
+                op.argc = 7;
+                masked = (op.arg[7] != 0);
+                if (op.arg[6] < 0 || op.arg[6] > SSD1306_FORMAT_BYTE) {
+                    if (error) error(ctx, index, "Unknown bitmap format");
+                    return index;
+                }
+                if (op.arg[2] > 0 && op.arg[3] > 0) {
+                    payload = ssd1306_bitmap_size(op.arg[6], op.arg[2], op.arg[3]);
+                }
+                break;
+        }
+
+        if (len - pos < payload * (masked ? 2 : 1)) {
+            if (error) error(ctx, index, "Truncated primitive");
+            break;
+        }
+        op.data = ops + pos;
+        op.data_len = payload;
+        pos += payload;
+        if (masked) {
+            op.mask = ops + pos;
+            op.mask_len = payload;
+            pos += payload;
+        }
+
+        message = ssd1306_draw_op_internal(display, &op);
+        if (message && error) {
+            error(ctx, index, message);
+        }
+        index++;
+    }
+
+    return index;
 }
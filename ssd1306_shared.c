@@ -0,0 +1,481 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP SSD1306 Extension - Shared Framebuffer                          |
+  +----------------------------------------------------------------------+
+  | Copyright (c) Project Saturn Studios, LLC                           |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_ssd1306.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * A shared display keeps its framebuffer in a named POSIX shared memory
+ * segment. Every attached process draws straight into the segment frame
+ * and publishes it by bumping a sequence counter. Exactly one process, the
+ * flusher, owns /dev/i2c-N: its thread waits for new sequence numbers,
+ * snapshots the frame and sends it with the usual shadow diff. Clients
+ * never touch the bus, so they need no panel at all.
+ */
+
+#define SSD1306_SHM_MAGIC    0x53534431  /* "SSD1" */
+
+/* Milliseconds between flusher liveness checks while waiting */
+#define SSD1306_SHM_POLL_MS  100
+
+struct ssd1306_shm {
+    uint32_t magic;          /* SSD1306_SHM_MAGIC once initialized */
+    int32_t width;
+    int32_t height;
+    int32_t flusher_pid;     /* Process running the flusher, 0 if none */
+    uint64_t seq;            /* Frames published */
+    uint64_t flushed_seq;    /* Newest published frame on the panel */
+    int32_t error;           /* errno of the last failed flush, 0 if none */
+    int32_t force;           /* Next flush must resend the whole frame */
+    pthread_mutex_t lock;    /* Process-shared and robust */
+    pthread_cond_t cond;     /* Frame published, flushed or flusher gone */
+    unsigned char headroom[SSD1306_BUFFER_HEADROOM];
+    unsigned char frame[];   /* Page-major framebuffer */
+};
+
+/* Turn a user supplied name into a shm_open() path ("/name") */
+static int ssd1306_shm_path(const char *name, char *path, size_t size)
+{
+    if (*name == '/') {
+        name++;
+    }
+    if (!*name || strchr(name, '/') || (size_t) snprintf(path, size, "/%s", name) >= size) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Lock the segment, recovering the lock if its holder died */
+static int ssd1306_shm_lock(ssd1306_shm_t *shm)
+{
+    int rc = pthread_mutex_lock(&shm->lock);
+
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&shm->lock);
+        rc = 0;
+    }
+    return rc;
+}
+
+/* Wait on the segment condition for at most ms milliseconds (lock held) */
+static void ssd1306_shm_wait(ssd1306_shm_t *shm, int ms)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    if (pthread_cond_timedwait(&shm->cond, &shm->lock, &deadline) == EOWNERDEAD) {
+        pthread_mutex_consistent(&shm->lock);
+    }
+}
+
+/* Whether a live process is flushing the segment (lock held) */
+static int ssd1306_shm_flusher_alive(ssd1306_shm_t *shm)
+{
+    pid_t pid = shm->flusher_pid;
+
+    if (pid == 0) {
+        return 0;
+    }
+    return pid == getpid() || kill(pid, 0) == 0 || errno == EPERM;
+}
+
+/* Set up the lock, condition and geometry of a newly created segment */
+static void ssd1306_shm_init(ssd1306_shm_t *shm, int width, int height)
+{
+    pthread_mutexattr_t mattr;
+    pthread_condattr_t cattr;
+
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&shm->lock, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&shm->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    shm->width = width;
+    shm->height = height;
+
+    /* Openers spin on the magic, so it goes last */
+    __atomic_store_n(&shm->magic, SSD1306_SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+/* Map the named segment, creating it for this geometry if it does not
+ * exist. An existing segment must have the same geometry. */
+static int ssd1306_shm_map(ssd1306_t *display, const char *name, int width, int height, int *created)
+{
+    char path[256];
+    size_t size = sizeof(ssd1306_shm_t) + width * (height / 8);
+    ssd1306_shm_t *shm;
+    struct stat st;
+    int fd, tries;
+
+    if (ssd1306_shm_path(name, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    *created = 1;
+    fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0 && errno == EEXIST) {
+        *created = 0;
+        fd = shm_open(path, O_RDWR, 0);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (*created) {
+        if (ftruncate(fd, size) != 0) {
+            close(fd);
+            shm_unlink(path);
+            return -1;
+        }
+    } else {
+        /* The creator sizes the segment right after creating it */
+        for (tries = 0; ; tries++) {
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                return -1;
+            }
+            if ((size_t) st.st_size == size) {
+                break;
+            }
+            if (st.st_size != 0 || tries >= 100) {
+                close(fd);
+                errno = EINVAL;
+                return -1;
+            }
+            usleep(10000);
+        }
+    }
+
+    shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        return -1;
+    }
+
+    if (*created) {
+        ssd1306_shm_init(shm, width, height);
+    } else {
+        for (tries = 0; __atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != SSD1306_SHM_MAGIC; tries++) {
+            if (tries >= 100) {
+                munmap(shm, size);
+                errno = EINVAL;
+                return -1;
+            }
+            usleep(10000);
+        }
+        if (shm->width != width || shm->height != height) {
+            munmap(shm, size);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    display->shm = shm;
+    display->shm_size = size;
+    return 0;
+}
+
+/* Attach a blank display to a shared framebuffer as a client. Clients draw
+ * and publish but have no I2C handle; the flusher sends their frames. */
+int ssd1306_shared_attach(ssd1306_t *display, const char *name, int width, int height)
+{
+    int created;
+
+    if (!ssd1306_size_supported(width, height)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ssd1306_init_state(display, width, height, SSD1306_SWITCHCAPVCC);
+    display->i2c_fd = -1;
+    display->transport = NULL;
+
+    display->dirty_x0 = malloc(sizeof(int) * display->pages * 2);
+    if (!display->dirty_x0) {
+        return -1;
+    }
+    display->dirty_x1 = display->dirty_x0 + display->pages;
+    ssd1306_mark_all_dirty(display);
+
+    if (ssd1306_shm_map(display, name, width, height, &created) != 0) {
+        free(display->dirty_x0);
+        display->dirty_x0 = NULL;
+        return -1;
+    }
+
+    display->buffer = display->shm->frame;
+    display->shadow = NULL;
+    display->shadow_valid = 0;
+    display->shm_flusher = 0;
+
+    ssd1306_async_init(display);
+    return 0;
+}
+
+/* Flusher thread: send every newly published frame until asked to stop.
+ * Frames published while one is on the bus collapse into the newest. */
+static void *ssd1306_shared_flusher(void *arg)
+{
+    ssd1306_t *display = arg;
+    ssd1306_shm_t *shm = display->shm;
+
+    ssd1306_shm_lock(shm);
+
+    for (;;) {
+        while (shm->seq == shm->flushed_seq && !display->shm_stop) {
+            if (pthread_cond_wait(&shm->cond, &shm->lock) == EOWNERDEAD) {
+                pthread_mutex_consistent(&shm->lock);
+            }
+        }
+        if (display->shm_stop) {
+            break;
+        }
+
+        uint64_t seq = shm->seq;
+        int force = shm->force;
+        shm->force = 0;
+        pthread_mutex_unlock(&shm->lock);
+
+        memcpy(display->shm_snapshot, shm->frame, display->buffer_size);
+        int result = ssd1306_flush_frame(display, display->shm_snapshot, force);
+        int error = errno;
+
+        ssd1306_shm_lock(shm);
+        shm->flushed_seq = seq;
+        shm->error = (result == 0) ? 0 : error;
+        pthread_cond_broadcast(&shm->cond);
+    }
+
+    pthread_mutex_unlock(&shm->lock);
+    return NULL;
+}
+
+/* Make an open display the flusher of a shared framebuffer. Its drawing
+ * buffer becomes the shared frame, and a thread sends published frames. */
+int ssd1306_shared_serve(ssd1306_t *display, const char *name)
+{
+    ssd1306_shm_t *shm;
+    unsigned char *block;
+    int created;
+
+    if (display->shm || !display->transport) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    block = malloc(SSD1306_BUFFER_HEADROOM + display->buffer_size);
+    if (!block) {
+        return -1;
+    }
+
+    if (ssd1306_shm_map(display, name, display->width, display->height, &created) != 0) {
+        free(block);
+        return -1;
+    }
+    shm = display->shm;
+
+    if (ssd1306_shm_lock(shm) != 0) {
+        munmap(shm, display->shm_size);
+        display->shm = NULL;
+        free(block);
+        return -1;
+    }
+    if (ssd1306_shm_flusher_alive(shm)) {
+        pthread_mutex_unlock(&shm->lock);
+        munmap(shm, display->shm_size);
+        display->shm = NULL;
+        free(block);
+        errno = EBUSY;
+        return -1;
+    }
+
+    /* A new segment starts out with what this display was showing */
+    if (created) {
+        memcpy(shm->frame, display->buffer, display->buffer_size);
+    }
+    shm->flusher_pid = getpid();
+    shm->seq++;  /* Bring the panel up to date with the shared frame */
+    pthread_mutex_unlock(&shm->lock);
+
+    display->shm_snapshot = block + SSD1306_BUFFER_HEADROOM;
+    display->shm_private = display->buffer;
+    display->buffer = shm->frame;
+    display->shm_stop = 0;
+    display->shm_flusher = 1;
+
+    if (pthread_create(&display->shm_thread, NULL, ssd1306_shared_flusher, display) != 0) {
+        ssd1306_shm_lock(shm);
+        shm->flusher_pid = 0;
+        pthread_mutex_unlock(&shm->lock);
+        display->buffer = display->shm_private;
+        display->shm_flusher = 0;
+        munmap(shm, display->shm_size);
+        display->shm = NULL;
+        free(block);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Publish the shared frame for the flusher and return immediately */
+int ssd1306_shared_publish(ssd1306_t *display, int force)
+{
+    ssd1306_shm_t *shm = display->shm;
+
+    if (ssd1306_shm_lock(shm) != 0) {
+        return -1;
+    }
+    shm->seq++;
+    shm->force |= force;
+    display->shm_published = shm->seq;
+    pthread_cond_broadcast(&shm->cond);
+    pthread_mutex_unlock(&shm->lock);
+
+    /* The flusher diffs whole frames, so the drawing bounds start afresh */
+    for (int page = 0; page < display->pages; page++) {
+        display->dirty_x0[page] = display->width;
+        display->dirty_x1[page] = -1;
+    }
+
+    return 0;
+}
+
+/* Block until the frames this process published are on the panel.
+ * Returns -1 if the flush failed or no flusher is running. */
+int ssd1306_shared_wait(ssd1306_t *display)
+{
+    ssd1306_shm_t *shm = display->shm;
+    int result = 0;
+
+    if (ssd1306_shm_lock(shm) != 0) {
+        return -1;
+    }
+    while (shm->flushed_seq < display->shm_published) {
+        if (!ssd1306_shm_flusher_alive(shm)) {
+            errno = ENOTCONN;
+            result = -1;
+            break;
+        }
+        ssd1306_shm_wait(shm, SSD1306_SHM_POLL_MS);
+    }
+    if (result == 0 && shm->error) {
+        errno = shm->error;
+        result = -1;
+    }
+    pthread_mutex_unlock(&shm->lock);
+
+    return result;
+}
+
+/* Whether frames this process published are still waiting for the flusher */
+int ssd1306_shared_busy(ssd1306_t *display)
+{
+    ssd1306_shm_t *shm = display->shm;
+    int busy;
+
+    if (ssd1306_shm_lock(shm) != 0) {
+        return 0;
+    }
+    busy = shm->flushed_seq < display->shm_published && ssd1306_shm_flusher_alive(shm);
+    pthread_mutex_unlock(&shm->lock);
+
+    return busy;
+}
+
+/* Sequence counters of the shared frame, for diagnostics */
+void ssd1306_shared_sequence(ssd1306_t *display, unsigned long *seq, unsigned long *flushed, int *flusher_pid)
+{
+    ssd1306_shm_t *shm = display->shm;
+
+    ssd1306_shm_lock(shm);
+    *seq = shm->seq;
+    *flushed = shm->flushed_seq;
+    *flusher_pid = ssd1306_shm_flusher_alive(shm) ? shm->flusher_pid : 0;
+    pthread_mutex_unlock(&shm->lock);
+}
+
+/* Stop flushing (if this display is the flusher) and unmap the segment.
+ * A flusher keeps the last shared frame as its own drawing buffer. */
+void ssd1306_shared_detach(ssd1306_t *display)
+{
+    ssd1306_shm_t *shm = display->shm;
+
+    if (!shm) {
+        return;
+    }
+
+    if (display->shm_flusher) {
+        ssd1306_shm_lock(shm);
+        display->shm_stop = 1;
+        pthread_cond_broadcast(&shm->cond);
+        pthread_mutex_unlock(&shm->lock);
+
+        pthread_join(display->shm_thread, NULL);
+
+        /* Wake clients waiting on a flusher that is gone */
+        ssd1306_shm_lock(shm);
+        shm->flusher_pid = 0;
+        pthread_cond_broadcast(&shm->cond);
+        pthread_mutex_unlock(&shm->lock);
+
+        memcpy(display->shm_private, shm->frame, display->buffer_size);
+        display->buffer = display->shm_private;
+        free(display->shm_snapshot - SSD1306_BUFFER_HEADROOM);
+        display->shm_snapshot = NULL;
+        display->shm_private = NULL;
+        display->shm_flusher = 0;
+    } else {
+        display->buffer = NULL;
+    }
+
+    munmap(shm, display->shm_size);
+    display->shm = NULL;
+}
+
+/* Remove a shared framebuffer name; attached processes keep their mapping */
+int ssd1306_shared_remove(const char *name)
+{
+    char path[256];
+
+    if (ssd1306_shm_path(name, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    return shm_unlink(path);
+}
@@ -0,0 +1,426 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP SSD1306 Extension - Virtual Transport                           |
+  +----------------------------------------------------------------------+
+  | Copyright (c) Project Saturn Studios, LLC                           |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_ssd1306.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <linux/i2c.h>
+
+/*
+ * The virtual transport stands in for a panel. Every transaction is kept
+ * in a ring buffer, and the byte stream is decoded like an SSD1306 would:
+ * command parameters, the three addressing modes and GDDRAM writes. Tests
+ * can then check the exact bus traffic and the resulting panel RAM without
+ * any hardware. Writes can also be made to fail, as a panel that does not
+ * acknowledge would, to exercise the error paths.
+ */
+
+#define SSD1306_VIRTUAL_LOG_ENTRIES 1024     /* Transactions kept */
+#define SSD1306_VIRTUAL_LOG_BYTES   65536    /* Packet bytes kept */
+
+#define SSD1306_VIRTUAL_PAGES       8
+#define SSD1306_VIRTUAL_COLUMNS     128
+
+typedef struct {
+    /* Panel RAM and addressing. RAM is kept in the column order of the
+     * remapped segments the driver programs by default; like the
+     * controller, the remap applies to data as it is written. */
+    unsigned char ram[SSD1306_VIRTUAL_PAGES][SSD1306_VIRTUAL_COLUMNS];
+    int addressing_mode;     /* 0 horizontal, 1 vertical, 2 page */
+    int col_start, col_end, col;
+    int page_start, page_end, page;
+
+    /* Command currently being decoded */
+    unsigned char cmd[8];
+    int cmd_len;
+
+    /* Panel state set by commands */
+    int display_on;
+    int inverted;
+    int contrast;
+    int scrolling;
+    int start_line;
+    int scroll_area_top;     /* Vertical scroll area (0xA3) */
+    int scroll_area_rows;
+    int segment_remap;       /* Column 127 drives SEG0 */
+    int com_reversed;        /* COM lines scanned from COM[N-1] to COM0 */
+
+    /* Transaction log */
+    struct {
+        uint64_t offset;     /* Position of the packet in the byte ring */
+        int len;
+    } log[SSD1306_VIRTUAL_LOG_ENTRIES];
+    unsigned char log_bytes[SSD1306_VIRTUAL_LOG_BYTES];
+    unsigned long log_count;     /* Transactions logged since the last clear */
+    uint64_t log_head;           /* Bytes logged since the last clear */
+
+    /* Totals since the display was opened */
+    unsigned long transactions;
+    unsigned long bytes;
+    unsigned long failed;
+
+    /* Writes still to fail; -1 fails them all */
+    long fail_writes;
+} ssd1306_virtual_t;
+
+#define VIRTUAL(display) ((ssd1306_virtual_t *) (display)->transport_data)
+
+static int ssd1306_virtual_open(ssd1306_t *display, int i2c_bus, int i2c_addr)
+{
+    ssd1306_virtual_t *panel = calloc(1, sizeof(ssd1306_virtual_t));
+
+    if (!panel) {
+        return -1;
+    }
+
+    panel->col_end = SSD1306_VIRTUAL_COLUMNS - 1;
+    panel->page_end = SSD1306_VIRTUAL_PAGES - 1;
+    panel->addressing_mode = 2;  /* Power-on default */
+    panel->contrast = 0x7F;
+    panel->scroll_area_rows = 64;
+
+    display->transport_data = panel;
+    display->i2c_fd = -1;
+
+    /* Behave like an adapter that speaks plain I2C and SMBus */
+    display->i2c_funcs = I2C_FUNC_I2C | I2C_FUNC_SMBUS_WRITE_I2C_BLOCK;
+    display->xfer_mode = SSD1306_XFER_WRITE;
+    display->xfer_chunk = 0;
+
+    return 0;
+}
+
+static void ssd1306_virtual_close(ssd1306_t *display)
+{
+    free(display->transport_data);
+    display->transport_data = NULL;
+}
+
+/* Parameter bytes that follow a command byte */
+static int ssd1306_virtual_params(unsigned char cmd)
+{
+    switch (cmd) {
+        case SSD1306_MEMORYMODE:
+        case SSD1306_SETCONTRAST:
+        case SSD1306_CHARGEPUMP:
+        case SSD1306_SETMULTIPLEX:
+        case SSD1306_SETDISPLAYOFFSET:
+        case SSD1306_SETDISPLAYCLOCKDIV:
+        case SSD1306_SETPRECHARGE:
+        case SSD1306_SETCOMPINS:
+        case SSD1306_SETVCOMDETECT:
+            return 1;
+        case SSD1306_COLUMNADDR:
+        case SSD1306_PAGEADDR:
+        case SSD1306_SET_VERTICAL_SCROLL_AREA:
+            return 2;
+        case SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL:
+        case SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL:
+            return 5;
+        case SSD1306_RIGHT_HORIZONTAL_SCROLL:
+        case SSD1306_LEFT_HORIZONTAL_SCROLL:
+            return 6;
+    }
+    return 0;
+}
+
+/* Apply a complete command */
+static void ssd1306_virtual_execute(ssd1306_virtual_t *panel)
+{
+    unsigned char cmd = panel->cmd[0];
+
+    if (cmd <= 0x0F) {
+        panel->col = (panel->col & 0xF0) | cmd;                   /* Page mode lower column */
+    } else if (cmd <= 0x1F) {
+        panel->col = (panel->col & 0x0F) | ((cmd & 0x0F) << 4);  /* Page mode higher column */
+    } else if (cmd >= 0x40 && cmd <= 0x7F) {
+        panel->start_line = cmd & 0x3F;
+    } else if (cmd >= 0xB0 && cmd <= 0xB7) {
+        panel->page = cmd & 0x07;                                 /* Page mode start page */
+    } else {
+        switch (cmd) {
+            case SSD1306_MEMORYMODE:
+                panel->addressing_mode = panel->cmd[1] & 0x03;
+                break;
+            case SSD1306_COLUMNADDR:
+                panel->col_start = panel->cmd[1] & 0x7F;
+                panel->col_end = panel->cmd[2] & 0x7F;
+                panel->col = panel->col_start;
+                break;
+            case SSD1306_PAGEADDR:
+                panel->page_start = panel->cmd[1] & 0x07;
+                panel->page_end = panel->cmd[2] & 0x07;
+                panel->page = panel->page_start;
+                break;
+            case SSD1306_SETCONTRAST:
+                panel->contrast = panel->cmd[1];
+                break;
+            case SSD1306_SET_VERTICAL_SCROLL_AREA:
+                panel->scroll_area_top = panel->cmd[1] & 0x3F;
+                panel->scroll_area_rows = panel->cmd[2] & 0x7F;
+                break;
+            case SSD1306_NORMALDISPLAY:
+            case SSD1306_INVERTDISPLAY:
+                panel->inverted = (cmd == SSD1306_INVERTDISPLAY);
+                break;
+            case SSD1306_DISPLAYOFF:
+            case SSD1306_DISPLAYON:
+                panel->display_on = (cmd == SSD1306_DISPLAYON);
+                break;
+            case SSD1306_ACTIVATE_SCROLL:
+            case SSD1306_DEACTIVATE_SCROLL:
+                panel->scrolling = (cmd == SSD1306_ACTIVATE_SCROLL);
+                break;
+            case SSD1306_SEGREMAP:
+            case SSD1306_SEGREMAP | 0x1:
+                panel->segment_remap = cmd & 0x1;
+                break;
+            case SSD1306_COMSCANINC:
+            case SSD1306_COMSCANDEC:
+                panel->com_reversed = (cmd == SSD1306_COMSCANDEC);
+                break;
+        }
+    }
+}
+
+/* Write one byte of GDDRAM and advance the address pointers */
+static void ssd1306_virtual_ram_write(ssd1306_virtual_t *panel, unsigned char value)
+{
+    int col = panel->segment_remap ? panel->col : SSD1306_VIRTUAL_COLUMNS - 1 - panel->col;
+
+    panel->ram[panel->page][col] = value;
+
+    switch (panel->addressing_mode) {
+        case 0:  /* Horizontal */
+            if (panel->col >= panel->col_end) {
+                panel->col = panel->col_start;
+                panel->page = (panel->page >= panel->page_end) ? panel->page_start : panel->page + 1;
+            } else {
+                panel->col++;
+            }
+            break;
+        case 1:  /* Vertical */
+            if (panel->page >= panel->page_end) {
+                panel->page = panel->page_start;
+                panel->col = (panel->col >= panel->col_end) ? panel->col_start : panel->col + 1;
+            } else {
+                panel->page++;
+            }
+            break;
+        default: /* Page */
+            panel->col = (panel->col >= SSD1306_VIRTUAL_COLUMNS - 1) ? 0 : panel->col + 1;
+            break;
+    }
+}
+
+/* Record and decode one message (control byte first). Called with the bus
+ * lock held, like every transport write. */
+static int ssd1306_virtual_write(ssd1306_t *display, unsigned char *packet, int len)
+{
+    ssd1306_virtual_t *panel = VIRTUAL(display);
+    unsigned long slot = panel->log_count % SSD1306_VIRTUAL_LOG_ENTRIES;
+
+    /* A failed write never reaches the panel and is not logged */
+    if (panel->fail_writes != 0) {
+        if (panel->fail_writes > 0) {
+            panel->fail_writes--;
+        }
+        panel->failed++;
+        errno = EIO;
+        return -1;
+    }
+
+    panel->log[slot].offset = panel->log_head;
+    panel->log[slot].len = len;
+    for (int i = 0; i < len; i++) {
+        panel->log_bytes[(panel->log_head + i) % SSD1306_VIRTUAL_LOG_BYTES] = packet[i];
+    }
+    panel->log_head += len;
+    panel->log_count++;
+    panel->transactions++;
+    panel->bytes += len;
+
+    if (packet[0] & 0x40) {
+        for (int i = 1; i < len; i++) {
+            ssd1306_virtual_ram_write(panel, packet[i]);
+        }
+    } else {
+        for (int i = 1; i < len; i++) {
+            panel->cmd[panel->cmd_len++] = packet[i];
+            if (panel->cmd_len > ssd1306_virtual_params(panel->cmd[0])) {
+                ssd1306_virtual_execute(panel);
+                panel->cmd_len = 0;
+            }
+        }
+    }
+
+    return 0;
+}
+
+const ssd1306_transport_t ssd1306_transport_virtual = {
+    "virtual",
+    ssd1306_virtual_open,
+    ssd1306_virtual_write,
+    ssd1306_virtual_close
+};
+
+#ifndef SSD1306_NO_PHP_API
+
+/* Fetch the virtual panel of the current display, with a warning if there is none */
+static ssd1306_virtual_t *php_ssd1306_virtual(ssd1306_t *display)
+{
+    if (!display) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display not initialized");
+        return NULL;
+    }
+    if (display->transport != &ssd1306_transport_virtual) {
+        php_error_docref(NULL, E_WARNING, "SSD1306 display does not use the virtual transport");
+        return NULL;
+    }
+    return VIRTUAL(display);
+}
+
+/* PHP Virtual Transport Functions */
+
+/* {{{ proto string ssd1306_virtual_ram()
+   Get the emulated panel RAM: 8 pages of 128 columns */
+PHP_FUNCTION(ssd1306_virtual_ram)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    ssd1306_virtual_t *panel;
+
+    if (!(panel = php_ssd1306_virtual(display))) {
+        RETURN_FALSE;
+    }
+
+    pthread_mutex_lock(&display->bus_lock);
+    RETVAL_STRINGL((char *) panel->ram, sizeof(panel->ram));
+    pthread_mutex_unlock(&display->bus_lock);
+}
+/* }}} */
+
+/* {{{ proto array ssd1306_virtual_log([bool clear])
+   Get the recorded transactions, oldest first, optionally clearing the log */
+PHP_FUNCTION(ssd1306_virtual_log)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    ssd1306_virtual_t *panel;
+    zend_bool clear = 0;
+    unsigned long first;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "|b", &clear) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!(panel = php_ssd1306_virtual(display))) {
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+
+    pthread_mutex_lock(&display->bus_lock);
+
+    first = (panel->log_count > SSD1306_VIRTUAL_LOG_ENTRIES) ? panel->log_count - SSD1306_VIRTUAL_LOG_ENTRIES : 0;
+    for (unsigned long n = first; n < panel->log_count; n++) {
+        unsigned long slot = n % SSD1306_VIRTUAL_LOG_ENTRIES;
+        uint64_t offset = panel->log[slot].offset;
+        int len = panel->log[slot].len;
+        zend_string *packet;
+        zval entry;
+
+        /* Packets whose bytes were overwritten are gone */
+        if (panel->log_head - offset > SSD1306_VIRTUAL_LOG_BYTES) {
+            continue;
+        }
+
+        packet = zend_string_alloc(len - 1, 0);
+        for (int i = 1; i < len; i++) {
+            ZSTR_VAL(packet)[i - 1] = panel->log_bytes[(offset + i) % SSD1306_VIRTUAL_LOG_BYTES];
+        }
+        ZSTR_VAL(packet)[len - 1] = '\0';
+
+        array_init(&entry);
+        add_assoc_long(&entry, "control", panel->log_bytes[offset % SSD1306_VIRTUAL_LOG_BYTES]);
+        add_assoc_str(&entry, "bytes", packet);
+        add_next_index_zval(return_value, &entry);
+    }
+
+    if (clear) {
+        panel->log_count = 0;
+        panel->log_head = 0;
+    }
+
+    pthread_mutex_unlock(&display->bus_lock);
+}
+/* }}} */
+
+/* {{{ proto array ssd1306_virtual_state()
+   Get the emulated panel state and bus totals */
+PHP_FUNCTION(ssd1306_virtual_state)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    ssd1306_virtual_t *panel;
+
+    if (!(panel = php_ssd1306_virtual(display))) {
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+
+    pthread_mutex_lock(&display->bus_lock);
+    add_assoc_long(return_value, "transactions", panel->transactions);
+    add_assoc_long(return_value, "bytes", panel->bytes);
+    add_assoc_long(return_value, "failed", panel->failed);
+    add_assoc_bool(return_value, "display_on", panel->display_on);
+    add_assoc_bool(return_value, "inverted", panel->inverted);
+    add_assoc_long(return_value, "contrast", panel->contrast);
+    add_assoc_bool(return_value, "scrolling", panel->scrolling);
+    add_assoc_long(return_value, "start_line", panel->start_line);
+    add_assoc_long(return_value, "scroll_area_top", panel->scroll_area_top);
+    add_assoc_long(return_value, "scroll_area_rows", panel->scroll_area_rows);
+    add_assoc_bool(return_value, "segment_remap", panel->segment_remap);
+    add_assoc_bool(return_value, "com_reversed", panel->com_reversed);
+    add_assoc_long(return_value, "addressing_mode", panel->addressing_mode);
+    pthread_mutex_unlock(&display->bus_lock);
+}
+/* }}} */
+
+/* {{{ proto bool ssd1306_virtual_fail(int count)
+   Make the next count writes fail with EIO; -1 fails every write, 0 stops */
+PHP_FUNCTION(ssd1306_virtual_fail)
+{
+    ssd1306_t *display = PHP_SSD1306_DISPLAY();
+    ssd1306_virtual_t *panel;
+    zend_long count;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &count) == FAILURE) {
+        RETURN_FALSE;
+    }
+
+    if (!(panel = php_ssd1306_virtual(display))) {
+        RETURN_FALSE;
+    }
+
+    pthread_mutex_lock(&display->bus_lock);
+    panel->fail_writes = (count < 0) ? -1 : count;
+    pthread_mutex_unlock(&display->bus_lock);
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+#endif /* SSD1306_NO_PHP_API */
@@ -10,6 +10,8 @@ var_dump(function_exists('ssd1306_start_scroll_left'));
 var_dump(function_exists('ssd1306_start_scroll_diag_right'));
 var_dump(function_exists('ssd1306_start_scroll_diag_left'));
 var_dump(function_exists('ssd1306_stop_scroll'));
+var_dump(function_exists('ssd1306_start_scroll'));
+var_dump(defined('SSD1306_SCROLL_DIAG_LEFT'));
 
 echo "Scrolling functions test completed\n";
 ?>
@@ -19,4 +21,6 @@ bool(true)
 bool(true)
 bool(true)
 bool(true)
+bool(true)
+bool(true)
 Scrolling functions test completed
@@ -0,0 +1,25 @@
+--TEST--
+SSD1306 Partial update and transfer statistics test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test function existence
+var_dump(function_exists('ssd1306_stats'));
+
+// ssd1306_display() takes an optional force flag
+$rf = new ReflectionFunction('ssd1306_display');
+var_dump($rf->getNumberOfParameters());
+var_dump($rf->getNumberOfRequiredParameters());
+
+// Without a display there are no statistics
+var_dump(@ssd1306_stats());
+
+echo "Partial update test completed\n";
+?>
+--EXPECT--
+bool(true)
+int(1)
+int(0)
+bool(false)
+Partial update test completed
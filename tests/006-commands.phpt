@@ -0,0 +1,18 @@
+--TEST--
+SSD1306 Batched command list test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test function existence
+var_dump(function_exists('ssd1306_commands'));
+
+// Without a display the command list is rejected
+var_dump(@ssd1306_commands([0xAE, 0xAF]));
+
+echo "Command list test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(false)
+Command list test completed
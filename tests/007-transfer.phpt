@@ -0,0 +1,30 @@
+--TEST--
+SSD1306 Transfer strategy and calibration test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test constants
+var_dump(SSD1306_XFER_WRITE);
+var_dump(SSD1306_XFER_RDWR);
+var_dump(SSD1306_XFER_SMBUS);
+
+// Test function existence
+var_dump(function_exists('ssd1306_set_transfer'));
+var_dump(function_exists('ssd1306_calibrate'));
+
+// Without a display there is nothing to calibrate
+var_dump(@ssd1306_calibrate());
+var_dump(@ssd1306_set_transfer(SSD1306_XFER_RDWR, 64));
+
+echo "Transfer test completed\n";
+?>
+--EXPECT--
+int(0)
+int(1)
+int(2)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
+Transfer test completed
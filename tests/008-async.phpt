@@ -0,0 +1,24 @@
+--TEST--
+SSD1306 Background update functions test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test function existence
+var_dump(function_exists('ssd1306_display_async'));
+var_dump(function_exists('ssd1306_wait'));
+var_dump(function_exists('ssd1306_is_busy'));
+
+// Without a display nothing can be queued
+var_dump(@ssd1306_display_async());
+var_dump(@ssd1306_is_busy());
+
+echo "Background update test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
+Background update test completed
@@ -0,0 +1,30 @@
+--TEST--
+SSD1306 Completion channel functions test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test constants
+var_dump(SSD1306_OP_DISPLAY);
+var_dump(SSD1306_OP_COMMANDS);
+
+// Test function existence
+var_dump(function_exists('ssd1306_commands_async'));
+var_dump(function_exists('ssd1306_completion_stream'));
+var_dump(function_exists('ssd1306_completions'));
+
+// Without a display there is no completion channel
+var_dump(@ssd1306_completion_stream());
+var_dump(@ssd1306_commands_async([0xAF]));
+
+echo "Completion channel test completed\n";
+?>
+--EXPECT--
+int(1)
+int(2)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
+Completion channel test completed
@@ -0,0 +1,43 @@
+--TEST--
+SSD1306 Display class test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test class and method existence
+var_dump(class_exists('SSD1306\Display'));
+var_dump(method_exists('SSD1306\Display', 'drawPixel'));
+var_dump(method_exists('SSD1306\Display', 'print'));
+var_dump(method_exists('SSD1306\Display', 'displayAsync'));
+
+// A panel that cannot be opened throws
+try {
+    new SSD1306\Display(255, SSD1306_I2C_ADDRESS_ALT);
+} catch (RuntimeException $e) {
+    echo $e->getMessage(), "\n";
+}
+
+// An instance without a panel behaves like the procedural API
+$display = (new ReflectionClass('SSD1306\Display'))->newInstanceWithoutConstructor();
+var_dump(@$display->getWidth());
+var_dump(@$display->display());
+
+// Panels cannot be shared between instances
+try {
+    clone $display;
+} catch (Error $e) {
+    echo get_class($e), "\n";
+}
+
+echo "Display class test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+Failed to initialize SSD1306 display at 0x3D on I2C bus 255
+int(0)
+bool(false)
+Error
+Display class test completed
@@ -0,0 +1,31 @@
+--TEST--
+SSD1306 Persistent display test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test function and method existence
+var_dump(function_exists('ssd1306_pbegin'));
+var_dump(method_exists('SSD1306\Display', 'persistent'));
+var_dump(method_exists('SSD1306\Display', 'pbegin'));
+
+// A panel that cannot be opened is not kept
+var_dump(@ssd1306_pbegin(255));
+var_dump(@ssd1306_get_width());
+
+try {
+    SSD1306\Display::persistent(255);
+} catch (RuntimeException $e) {
+    echo $e->getMessage(), "\n";
+}
+
+echo "Persistent display test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+int(0)
+Failed to initialize SSD1306 display at 0x3C on I2C bus 255
+Persistent display test completed
@@ -0,0 +1,56 @@
+--TEST--
+SSD1306 Shared framebuffer test (no panel required)
+--SKIPIF--
+<?php
+if (!extension_loaded('ssd1306')) print 'skip';
+elseif (!is_dir('/dev/shm')) print 'skip no POSIX shared memory';
+?>
+--FILE--
+<?php
+$name = 'ssd1306-test-' . getmypid();
+
+// Test function existence
+var_dump(function_exists('ssd1306_shared_begin'));
+var_dump(function_exists('ssd1306_shared_serve'));
+var_dump(function_exists('ssd1306_shared_remove'));
+
+// Clients draw and publish without a bus
+var_dump(ssd1306_shared_begin($name));
+ssd1306_draw_pixel(3, 4, SSD1306_WHITE);
+var_dump(ssd1306_display());
+$stats = ssd1306_stats();
+var_dump($stats['shared_sequence']);
+var_dump($stats['shared_flusher_pid']);
+
+// Nothing sends the frame yet, and clients cannot talk to the panel
+var_dump(ssd1306_wait());
+var_dump(ssd1306_set_contrast(10));
+
+// A second attachment sees the same frame
+$other = (new ReflectionClass('SSD1306\Display'))->newInstanceWithoutConstructor();
+var_dump($other->sharedBegin($name));
+var_dump($other->getPixel(3, 4));
+
+// The geometry must match the segment
+var_dump(@$other->sharedBegin($name, 128, 32));
+
+ssd1306_end();
+var_dump(ssd1306_shared_remove($name));
+
+echo "Shared framebuffer test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+int(1)
+int(0)
+bool(false)
+bool(false)
+bool(true)
+int(1)
+bool(false)
+bool(true)
+Shared framebuffer test completed
@@ -0,0 +1,100 @@
+--TEST--
+SSD1306 Virtual transport test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Test function and constant existence
+var_dump(function_exists('ssd1306_virtual_ram'));
+var_dump(function_exists('ssd1306_virtual_log'));
+var_dump(function_exists('ssd1306_virtual_state'));
+var_dump(defined('SSD1306_TRANSPORT_I2C'));
+var_dump(defined('SSD1306_TRANSPORT_VIRTUAL'));
+
+// Without a display there is no virtual panel
+var_dump(@ssd1306_virtual_ram());
+
+// Unknown transports are rejected
+var_dump(@ssd1306_begin(0, 0x3C, 128, 64, SSD1306_SWITCHCAPVCC, 99));
+
+// The virtual panel needs no hardware
+var_dump(ssd1306_begin(0, 0x3C, 128, 64, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+var_dump(ssd1306_stats()['transport']);
+
+// Initialization is one command transaction
+$log = ssd1306_virtual_log(true);
+var_dump(count($log), $log[0]['control'], bin2hex($log[0]['bytes']));
+
+$state = ssd1306_virtual_state();
+var_dump($state['display_on'], $state['contrast'], $state['addressing_mode']);
+
+// The first update sends the whole frame behind one address window
+ssd1306_draw_pixel(10, 10, SSD1306_WHITE);
+ssd1306_display();
+$log = ssd1306_virtual_log(true);
+var_dump(count($log), bin2hex($log[0]['bytes']), $log[1]['control'], strlen($log[1]['bytes']));
+
+// Later updates send only what changed
+ssd1306_draw_pixel(20, 20, SSD1306_WHITE);
+ssd1306_display();
+foreach (ssd1306_virtual_log(true) as $txn) {
+    printf("%02x %s\n", $txn['control'], bin2hex($txn['bytes']));
+}
+
+// Unchanged frames cause no traffic
+ssd1306_display();
+var_dump(count(ssd1306_virtual_log()));
+
+// Panel RAM holds both pixels
+$ram = ssd1306_virtual_ram();
+var_dump(strlen($ram), ord($ram[128 + 10]), ord($ram[256 + 20]));
+
+// SMBus block writes split data into 32 byte transactions
+var_dump(ssd1306_set_transfer(SSD1306_XFER_SMBUS));
+ssd1306_display(true);
+var_dump(count(ssd1306_virtual_log(true)));
+
+ssd1306_invert_display(true);
+var_dump(ssd1306_virtual_state()['inverted']);
+
+ssd1306_end();
+
+// Panels opened by instances have their own virtual RAM
+$panel = new SSD1306\Display(0, 0x3C, 128, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+$panel->fillRect(0, 24, 8, 8, SSD1306_WHITE);
+$panel->display();
+var_dump(bin2hex(substr($panel->virtualRam(), 3 * 128, 9)));
+
+echo "Virtual transport test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
+bool(true)
+string(7) "virtual"
+int(1)
+int(0)
+string(52) "aed580a83fd300408d142000a1c8da1281cfd9f1db40a4a62eaf"
+bool(true)
+int(207)
+int(0)
+int(2)
+string(12) "21007f220007"
+int(64)
+int(1024)
+00 211414220202
+40 10
+int(0)
+int(1024)
+int(4)
+int(16)
+bool(true)
+int(33)
+bool(true)
+string(18) "ffffffffffffffff00"
+Virtual transport test completed
@@ -0,0 +1,62 @@
+--TEST--
+SSD1306 Instrumentation counters test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+// Test function existence
+var_dump(function_exists('ssd1306_reset_stats'));
+var_dump(method_exists('SSD1306\Display', 'resetStats'));
+
+// Without a display there is nothing to reset
+var_dump(@ssd1306_reset_stats());
+
+virtual_begin();
+
+// Initialization is the only transaction so far
+$stats = ssd1306_stats();
+var_dump($stats['transactions'], $stats['write_errors'], $stats['flushes']);
+
+var_dump(ssd1306_reset_stats());
+$stats = ssd1306_stats();
+var_dump($stats['transactions'], $stats['bytes_sent']);
+
+// One full update: window commands plus one data transaction
+ssd1306_fill_rect(0, 0, 16, 16, SSD1306_WHITE);
+ssd1306_print("Hi");
+ssd1306_display();
+ssd1306_display();
+
+$stats = ssd1306_stats();
+var_dump($stats['flushes'], $stats['transactions'], $stats['render_calls']);
+var_dump(array_sum($stats['flush_histogram']));
+var_dump(count($stats['flush_histogram']));
+var_dump($stats['flush_p50_us'] <= $stats['flush_p99_us']);
+var_dump($stats['flush_p99_us'] <= $stats['flush_max_us']);
+var_dump($stats['io_time_us'] <= $stats['flush_time_us']);
+
+ssd1306_end();
+
+echo "Instrumentation test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(false)
+int(1)
+int(0)
+int(0)
+bool(true)
+int(0)
+int(0)
+int(2)
+int(2)
+int(2)
+int(2)
+int(24)
+bool(true)
+bool(true)
+bool(true)
+Instrumentation test completed
@@ -0,0 +1,53 @@
+--TEST--
+SSD1306 Span rectangle fill test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// Rows 3..12 cover the top of page 0 and the bottom of page 1
+ssd1306_fill_rect(0, 3, 4, 10, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 5), page_bytes(1, 0, 5));
+
+// Black clears only the covered bits
+ssd1306_fill_rect(1, 4, 2, 2, SSD1306_BLACK);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 4));
+
+// Inverse flips whole pages and partial ones
+ssd1306_fill_rect(0, 0, 2, 24, SSD1306_INVERSE);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 3), page_bytes(1, 0, 3), page_bytes(2, 0, 3));
+
+// Clipped to the panel
+ssd1306_fill_rect(-10, -10, 1000, 1000, SSD1306_WHITE);
+var_dump(ssd1306_get_pixel(0, 0), ssd1306_get_pixel(127, 63));
+ssd1306_display();
+var_dump(strspn(ssd1306_virtual_ram(), "\xFF"));
+
+// Empty rectangles draw nothing
+ssd1306_clear_display();
+ssd1306_fill_rect(10, 10, 0, 5, SSD1306_WHITE);
+ssd1306_fill_rect(10, 10, 5, -1, SSD1306_WHITE);
+ssd1306_display();
+var_dump(trim(ssd1306_virtual_ram(), "\0"));
+
+ssd1306_end();
+echo "Fill rect test completed\n";
+?>
+--EXPECT--
+string(10) "f8f8f8f800"
+string(10) "1f1f1f1f00"
+string(8) "f8c8c8f8"
+string(6) "0737c8"
+string(6) "e0e01f"
+string(6) "ffff00"
+int(1)
+int(1)
+int(1024)
+string(0) ""
+Fill rect test completed
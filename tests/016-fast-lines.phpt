@@ -0,0 +1,65 @@
+--TEST--
+SSD1306 Fast horizontal and vertical line test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// One bit across a single page
+ssd1306_draw_fast_hline(2, 10, 5, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(1, 0, 8));
+
+// Rows 5..16 span three pages of one column
+ssd1306_draw_fast_vline(0, 5, 12, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 1), page_bytes(1, 0, 1), page_bytes(2, 0, 1));
+
+// Axis-aligned lines take the same path, in either direction
+ssd1306_draw_line(10, 7, 10, 0, SSD1306_INVERSE);
+ssd1306_draw_line(20, 9, 12, 9, SSD1306_INVERSE);
+ssd1306_display();
+var_dump(page_bytes(0, 10, 1), page_bytes(1, 10, 12));
+
+// Inverse outlines touch every pixel once, corners included
+ssd1306_clear_display();
+ssd1306_draw_rect(0, 0, 4, 4, SSD1306_INVERSE);
+ssd1306_draw_rect(8, 0, 1, 1, SSD1306_INVERSE);
+ssd1306_draw_rect(10, 0, 3, 1, SSD1306_INVERSE);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 13));
+
+// Clipped to the panel; empty lines draw nothing
+ssd1306_clear_display();
+ssd1306_draw_fast_hline(-10, 63, 1000, SSD1306_WHITE);
+ssd1306_draw_fast_vline(127, -10, 1000, SSD1306_WHITE);
+ssd1306_draw_fast_hline(5, 5, 0, SSD1306_WHITE);
+ssd1306_draw_fast_vline(5, 5, -3, SSD1306_WHITE);
+var_dump(ssd1306_get_pixel(0, 63), ssd1306_get_pixel(127, 0), ssd1306_get_pixel(5, 5));
+
+$display = new SSD1306\Display(0, 0x3C, 128, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+$display->drawFastHLine(0, 0, 128, SSD1306_WHITE);
+$display->drawFastVLine(0, 0, 32, SSD1306_WHITE);
+var_dump($display->getPixel(127, 0), $display->getPixel(0, 31));
+unset($display);
+
+ssd1306_end();
+echo "Fast line test completed\n";
+?>
+--EXPECT--
+string(16) "0000040404040400"
+string(2) "e0"
+string(2) "ff"
+string(2) "01"
+string(2) "ff"
+string(24) "000002020202020202020200"
+string(26) "0f09090f000000000100010101"
+int(1)
+int(1)
+int(0)
+int(1)
+int(1)
+Fast line test completed
@@ -0,0 +1,65 @@
+--TEST--
+SSD1306 Circle, ellipse and rounded rectangle span test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// Shapes centred on row 3 fit in page 0
+ssd1306_fill_circle(5, 3, 3, SSD1306_WHITE);
+ssd1306_draw_ellipse(20, 3, 6, 3, SSD1306_WHITE);
+ssd1306_fill_ellipse(40, 3, 6, 3, SSD1306_WHITE);
+ssd1306_fill_round_rect(60, 0, 9, 7, 3, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 2, 7), page_bytes(0, 14, 13), page_bytes(0, 34, 13), page_bytes(0, 60, 9));
+
+// A square of side 2r + 1 with radius r is the filled circle
+ssd1306_fill_round_rect(80, 0, 7, 7, 3, SSD1306_WHITE);
+ssd1306_fill_circle(93, 3, 3, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 80, 7) === page_bytes(0, 90, 7));
+
+// Zero radii give lines; negative radii draw nothing
+ssd1306_draw_ellipse(100, 4, 0, 3, SSD1306_WHITE);
+ssd1306_fill_ellipse(112, 4, 3, 0, SSD1306_WHITE);
+ssd1306_fill_ellipse(120, 4, -1, 3, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 100, 1), page_bytes(0, 109, 7), page_bytes(0, 117, 7));
+
+// Outlines touch each pixel once, so inverting twice restores the frame
+ssd1306_clear_display();
+ssd1306_draw_ellipse(64, 32, 50, 20, SSD1306_INVERSE);
+ssd1306_draw_ellipse(64, 32, 50, 20, SSD1306_INVERSE);
+ssd1306_fill_round_rect(-5, -5, 200, 100, 30, SSD1306_INVERSE);
+ssd1306_fill_round_rect(-5, -5, 200, 100, 30, SSD1306_INVERSE);
+ssd1306_display();
+var_dump(trim(ssd1306_virtual_ram(), "\0"));
+
+$display = new SSD1306\Display(0, 0x3C, 128, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+$display->fillEllipse(64, 16, 60, 15, SSD1306_WHITE);
+$display->drawEllipse(64, 16, 60, 15, SSD1306_BLACK);
+$display->fillRoundRect(0, 0, 10, 10, 2, SSD1306_WHITE);
+var_dump($display->getPixel(64, 16), $display->getPixel(64, 1), $display->getPixel(0, 0), $display->getPixel(1, 1));
+unset($display);
+
+ssd1306_end();
+echo "Ellipse test completed\n";
+?>
+--EXPECT--
+string(14) "083e3e7f3e3e08"
+string(26) "08142222222241222222221408"
+string(26) "081c3e3e3e3e7f3e3e3e3e1c08"
+string(18) "083e3e7f7f7f3e3e08"
+bool(true)
+string(2) "fe"
+string(14) "10101010101010"
+string(14) "00000000000000"
+string(0) ""
+int(1)
+int(0)
+int(0)
+int(1)
+Ellipse test completed
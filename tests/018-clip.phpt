@@ -0,0 +1,145 @@
+--TEST--
+SSD1306 Clip rectangle test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+var_dump(ssd1306_get_clip());
+
+// Fills stop at the clip edges
+var_dump(ssd1306_set_clip(10, 8, 20, 8));
+var_dump(ssd1306_get_clip());
+ssd1306_fill_rect(0, 0, 128, 64, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(1, 9, 22), page_bytes(0, 10, 1), page_bytes(2, 10, 1));
+
+// Lines keep the pixels the unclipped line would have
+ssd1306_clear_display();
+ssd1306_set_clip(20, 0, 10, 8);
+ssd1306_draw_line(0, 0, 60, 7, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 18, 14));
+
+// Text is cut at the clip, glyphs outside it are skipped
+ssd1306_clear_display();
+ssd1306_set_clip(0, 0, 3, 5);
+ssd1306_set_cursor(0, 0);
+ssd1306_print("AA");
+ssd1306_display();
+var_dump(page_bytes(0, 0, 8));
+
+// The clip is intersected with the panel; an empty clip draws nothing
+ssd1306_set_clip(-10, -10, 50, 1000);
+var_dump(ssd1306_get_clip());
+ssd1306_set_clip(200, 0, 10, 10);
+var_dump(ssd1306_get_clip());
+ssd1306_clear_display();
+ssd1306_fill_circle(64, 32, 30, SSD1306_WHITE);
+ssd1306_display();
+var_dump(trim(ssd1306_virtual_ram(), "\0"));
+
+// Far-away coordinates are clipped, not truncated or walked pixel by pixel
+var_dump(ssd1306_reset_clip());
+$far = PHP_INT_SIZE == 8 ? (1 << 32) + 5 : PHP_INT_MAX;
+ssd1306_draw_pixel($far, 5, SSD1306_WHITE);
+ssd1306_draw_line(0, 0, 100000000, 5, SSD1306_WHITE);
+ssd1306_draw_line(-$far, 40, $far, 40, SSD1306_WHITE);
+var_dump(ssd1306_get_pixel(5, 5), ssd1306_get_pixel(127, 0), ssd1306_get_pixel(64, 40));
+
+// Clearing the display ignores the clip
+ssd1306_set_clip(0, 0, 1, 1);
+ssd1306_clear_display();
+var_dump(ssd1306_get_pixel(127, 0));
+
+$display = new SSD1306\Display(0, 0x3C, 128, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+var_dump($display->getClip());
+$display->setClip(0, 0, 64, 32);
+$display->fillRect(0, 0, 128, 32, SSD1306_WHITE);
+var_dump($display->getPixel(63, 31), $display->getPixel(64, 0));
+$display->resetClip();
+var_dump($display->getClip());
+unset($display);
+
+ssd1306_end();
+echo "Clip test completed\n";
+?>
+--EXPECT--
+array(4) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+  [2]=>
+  int(128)
+  [3]=>
+  int(64)
+}
+bool(true)
+array(4) {
+  [0]=>
+  int(10)
+  [1]=>
+  int(8)
+  [2]=>
+  int(20)
+  [3]=>
+  int(8)
+}
+string(44) "00ffffffffffffffffffffffffffffffffffffffff00"
+string(2) "00"
+string(2) "00"
+string(28) "0000040408080808080808080000"
+string(16) "1e11110000000000"
+array(4) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+  [2]=>
+  int(40)
+  [3]=>
+  int(64)
+}
+array(4) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+  [2]=>
+  int(0)
+  [3]=>
+  int(0)
+}
+string(0) ""
+bool(true)
+int(0)
+int(1)
+int(1)
+int(0)
+array(4) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+  [2]=>
+  int(128)
+  [3]=>
+  int(32)
+}
+int(1)
+int(0)
+array(4) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+  [2]=>
+  int(128)
+  [3]=>
+  int(32)
+}
+Clip test completed
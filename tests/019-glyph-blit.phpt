@@ -0,0 +1,68 @@
+--TEST--
+SSD1306 Glyph column blitting test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// Page aligned: font columns land as whole bytes
+ssd1306_set_cursor(0, 0);
+ssd1306_print("Hi");
+ssd1306_display();
+var_dump(page_bytes(0, 0, 12));
+
+// Unaligned: each column is split across two pages
+ssd1306_set_cursor(0, 11);
+ssd1306_print("Hi");
+ssd1306_display();
+var_dump(page_bytes(1, 0, 12), page_bytes(2, 0, 12));
+
+// Scaled: every font bit becomes a 2x2 block
+ssd1306_set_text_size(2);
+ssd1306_set_cursor(0, 32);
+ssd1306_print("A");
+ssd1306_display();
+var_dump(page_bytes(4, 0, 12), page_bytes(5, 0, 12));
+
+// Inverse text flips the glyph and clears the background
+ssd1306_set_text_size(1);
+ssd1306_fill_rect(40, 0, 6, 8, SSD1306_WHITE);
+ssd1306_set_text_color(SSD1306_INVERSE);
+ssd1306_set_cursor(40, 0);
+ssd1306_print("H");
+ssd1306_display();
+var_dump(page_bytes(0, 40, 6));
+
+// Large sizes and clipped glyphs
+ssd1306_clear_display();
+ssd1306_set_text_color(SSD1306_WHITE);
+ssd1306_set_text_size(9);
+ssd1306_set_cursor(0, 0);
+ssd1306_print("|");
+var_dump(ssd1306_get_pixel(18, 0), ssd1306_get_pixel(26, 62), ssd1306_get_pixel(17, 0), ssd1306_get_pixel(27, 0));
+ssd1306_clear_display();
+ssd1306_set_text_size(1);
+ssd1306_set_cursor(-3, -2);
+ssd1306_print("H");
+ssd1306_display();
+var_dump(page_bytes(0, 0, 3));
+
+ssd1306_end();
+echo "Glyph blit test completed\n";
+?>
+--EXPECT--
+string(24) "7f0808087f0000447d400000"
+string(24) "f8404040f8000020e8000000"
+string(24) "030000000300000203020000"
+string(24) "fcfc030303030303fcfc0000"
+string(24) "3f3f0303030303033f3f0000"
+string(12) "0000000000ff"
+int(1)
+int(1)
+int(0)
+int(0)
+string(6) "021f00"
+Glyph blit test completed
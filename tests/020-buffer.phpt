@@ -0,0 +1,75 @@
+--TEST--
+SSD1306 framebuffer import and export test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// Native page order: one byte per column of each page
+ssd1306_fill_rect(0, 0, 8, 8, SSD1306_WHITE);
+ssd1306_draw_pixel(9, 1, SSD1306_WHITE);
+$page = ssd1306_get_buffer();
+var_dump(strlen($page), bin2hex(substr($page, 0, 10)));
+
+// Packed rows (MSB and LSB first) and one byte per pixel
+$row = ssd1306_get_buffer(SSD1306_FORMAT_ROW);
+$xbm = ssd1306_get_buffer(SSD1306_FORMAT_XBM);
+$bytes = ssd1306_get_buffer(SSD1306_FORMAT_BYTE);
+var_dump(strlen($row), bin2hex(substr($row, 16, 2)));
+var_dump(strlen($xbm), bin2hex(substr($xbm, 16, 2)));
+var_dump(strlen($bytes), bin2hex(substr($bytes, 128 + 6, 4)));
+
+// Round trip through every format
+foreach ([SSD1306_FORMAT_ROW, SSD1306_FORMAT_XBM, SSD1306_FORMAT_BYTE] as $format) {
+    $frame = ssd1306_get_buffer($format);
+    ssd1306_clear_display();
+    ssd1306_set_buffer($frame, 0, $format);
+    var_dump(ssd1306_get_buffer() === $page);
+}
+
+// Partial writes land at the offset and reach the panel
+ssd1306_clear_display();
+ssd1306_display();
+var_dump(ssd1306_set_buffer("\xff\x81", 130));
+var_dump(ssd1306_set_buffer(str_repeat("\xf0", 16), 16 * 16, SSD1306_FORMAT_ROW));
+var_dump(ssd1306_set_buffer("\x01\x00\x07", 128 * 63 + 125, SSD1306_FORMAT_BYTE));
+ssd1306_display();
+var_dump(page_bytes(1, 0, 4), page_bytes(2, 0, 9), page_bytes(7, 125, 3));
+
+// Data that does not fit and unknown formats are rejected
+var_dump(@ssd1306_set_buffer(str_repeat("\x00", 1025)));
+var_dump(@ssd1306_set_buffer("\x00", 1024));
+var_dump(@ssd1306_set_buffer("\x00", -1));
+var_dump(@ssd1306_get_buffer(9));
+var_dump(page_bytes(1, 0, 4));
+
+ssd1306_end();
+echo "Buffer test completed\n";
+?>
+--EXPECT--
+int(1024)
+string(20) "ffffffffffffffff0002"
+int(1024)
+string(4) "ff40"
+int(1024)
+string(4) "ff02"
+int(8192)
+string(8) "01010001"
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+string(8) "0000ff81"
+string(18) "010101010000000001"
+string(6) "800080"
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+string(8) "0000ff81"
+Buffer test completed
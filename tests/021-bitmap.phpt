@@ -0,0 +1,59 @@
+--TEST--
+SSD1306 bitmap drawing test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// Packed rows: leftmost pixel in the MSB by default, in the LSB for XBM
+$diagonal = "\x80\x40\x20\x10\x08\x04\x02\x01";
+var_dump(ssd1306_draw_bitmap(0, 0, $diagonal, 8, 8, SSD1306_WHITE));
+var_dump(ssd1306_draw_bitmap(8, 0, $diagonal, 8, 8, SSD1306_WHITE, -1, SSD1306_FORMAT_XBM));
+ssd1306_display();
+var_dump(page_bytes(0, 0, 16));
+
+// Page-native columns shifted across two pages
+ssd1306_draw_bitmap(0, 12, "\xff\x81\xff", 3, 8, SSD1306_WHITE, -1, SSD1306_FORMAT_PAGE);
+ssd1306_display();
+var_dump(page_bytes(1, 0, 3), page_bytes(2, 0, 3));
+
+// Background color limited by a mask
+ssd1306_fill_rect(32, 0, 8, 8, SSD1306_WHITE);
+ssd1306_draw_bitmap(32, 0, str_repeat("\x00", 8), 8, 8, SSD1306_WHITE, SSD1306_BLACK,
+                    SSD1306_FORMAT_ROW, str_repeat("\xf0", 8));
+ssd1306_display();
+var_dump(page_bytes(0, 32, 8));
+
+// Clipped at the panel edges
+ssd1306_clear_display();
+ssd1306_draw_bitmap(120, 60, str_repeat("\xff", 32), 16, 16, SSD1306_WHITE);
+ssd1306_draw_bitmap(-4, -4, str_repeat("\xff", 8), 8, 8, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(7, 118, 10), page_bytes(0, 0, 5));
+
+// Short data and unknown formats are rejected; empty bitmaps draw nothing
+var_dump(@ssd1306_draw_bitmap(0, 0, "\xff", 16, 16, SSD1306_WHITE));
+var_dump(@ssd1306_draw_bitmap(0, 0, $diagonal, 8, 8, SSD1306_WHITE, -1, SSD1306_FORMAT_ROW, "\xff"));
+var_dump(@ssd1306_draw_bitmap(0, 0, $diagonal, 8, 8, SSD1306_WHITE, -1, 9));
+var_dump(ssd1306_draw_bitmap(0, 0, "", 0, 8, SSD1306_WHITE));
+
+ssd1306_end();
+echo "Bitmap test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+string(32) "01020408102040808040201008040201"
+string(6) "f010f0"
+string(6) "0f080f"
+string(16) "00000000ffffffff"
+string(20) "0000f0f0f0f0f0f0f0f0"
+string(10) "0f0f0f0f00"
+bool(false)
+bool(false)
+bool(false)
+bool(true)
+Bitmap test completed
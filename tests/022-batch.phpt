@@ -0,0 +1,77 @@
+--TEST--
+SSD1306 batched drawing test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// Array form: one list entry per primitive
+var_dump(ssd1306_draw_batch([
+    [SSD1306_DRAW_PIXEL, 0, 0, SSD1306_WHITE],
+    [SSD1306_DRAW_LINE, 1, 0, 1, 7, SSD1306_WHITE],
+    [SSD1306_DRAW_FILL_RECT, 2, 4, 2, 4, SSD1306_WHITE],
+    [SSD1306_DRAW_CHAR, 8, 0, "H", SSD1306_WHITE],
+    [SSD1306_DRAW_TEXT, 0, 8, "i"],
+    [SSD1306_DRAW_BITMAP, 16, 0, "\xff\x81", 8, 2, SSD1306_WHITE],
+]));
+ssd1306_display();
+var_dump(page_bytes(0, 0, 24), page_bytes(1, 0, 5));
+
+// Malformed primitives are skipped and reported by key
+var_dump(ssd1306_draw_batch([
+    'a' => [99],
+    3 => [SSD1306_DRAW_PIXEL, 1],
+    [SSD1306_DRAW_PIXEL, 1, 2, 3, 4],
+    [SSD1306_DRAW_BITMAP, 0, 0, "x", 16, 16, SSD1306_WHITE],
+    "nope",
+]));
+
+// Packed form: opcode byte, 16-bit little-endian arguments, payload
+ssd1306_clear_display();
+$ops = pack('Cv3', SSD1306_DRAW_PIXEL, 5, 5, SSD1306_WHITE)
+     . pack('Cv5', SSD1306_DRAW_FILL_RECT, 10, 0, 4, 8, SSD1306_WHITE)
+     . pack('Cv3', SSD1306_DRAW_TEXT, 0, 8, 2) . "Hi";
+var_dump(ssd1306_draw_batch($ops));
+ssd1306_display();
+var_dump(page_bytes(0, 4, 10), page_bytes(1, 0, 11));
+
+// A truncated or unknown primitive ends a packed batch
+var_dump(ssd1306_draw_batch(pack('Cv3', SSD1306_DRAW_PIXEL, 0, 0, 1) . pack('Cv2', SSD1306_DRAW_LINE, 0, 0)));
+var_dump(ssd1306_draw_batch("\x63"));
+
+ssd1306_end();
+echo "Batch test completed\n";
+?>
+--EXPECT--
+array(0) {
+}
+string(48) "01fff0f0000000007f0808087f0000000301010101010103"
+string(10) "00447d4000"
+array(5) {
+  ["a"]=>
+  string(17) "Unknown primitive"
+  [3]=>
+  string(17) "Missing arguments"
+  [4]=>
+  string(18) "Too many arguments"
+  [5]=>
+  string(21) "Bitmap data too short"
+  [6]=>
+  string(26) "Primitive must be an array"
+}
+array(0) {
+}
+string(20) "002000000000ffffffff"
+string(22) "7f0808087f0000447d4000"
+array(1) {
+  [1]=>
+  string(19) "Truncated primitive"
+}
+array(1) {
+  [0]=>
+  string(17) "Unknown primitive"
+}
+Batch test completed
@@ -0,0 +1,112 @@
+--TEST--
+SSD1306 rotation test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+function flip_state() {
+    $state = ssd1306_virtual_state();
+    return [$state['segment_remap'], $state['com_reversed']];
+}
+
+var_dump(ssd1306_get_rotation(), flip_state());
+
+// A quarter turn swaps the axes in the rasterizer
+var_dump(ssd1306_set_rotation(1));
+var_dump(ssd1306_get_width(), ssd1306_get_height(), ssd1306_get_clip());
+ssd1306_fill_rect(0, 0, 8, 2, SSD1306_WHITE);
+ssd1306_draw_pixel(10, 3, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 124, 4), page_bytes(1, 124, 1), ssd1306_get_pixel(10, 3), flip_state());
+
+// Half turns are done by the panel; the framebuffer keeps its layout. The
+// segment remap only applies to data written after it, so the next update
+// rewrites the whole frame, which the panel stores mirrored
+ssd1306_set_rotation(0);
+ssd1306_clear_display();
+ssd1306_draw_pixel(0, 0, SSD1306_WHITE);
+ssd1306_display();
+ssd1306_virtual_log(true);
+var_dump(ssd1306_set_rotation(2), ssd1306_get_width(), flip_state());
+ssd1306_display();
+$log = ssd1306_virtual_log(true);
+var_dump(count($log), strlen($log[2]['bytes']), page_bytes(0, 0, 1), page_bytes(0, 127, 1));
+
+// Three quarters: the panel flip plus the swapped axes
+var_dump(ssd1306_set_rotation(3), ssd1306_get_height(), flip_state());
+ssd1306_draw_pixel(10, 3, SSD1306_WHITE);
+var_dump(ssd1306_get_pixel(10, 3));
+
+var_dump(@ssd1306_set_rotation(4), @ssd1306_set_rotation(-1), ssd1306_get_rotation());
+var_dump(ssd1306_set_rotation(0), ssd1306_get_width(), flip_state());
+
+ssd1306_end();
+echo "Rotation test completed\n";
+?>
+--EXPECT--
+int(0)
+array(2) {
+  [0]=>
+  bool(true)
+  [1]=>
+  bool(true)
+}
+bool(true)
+int(64)
+int(128)
+array(4) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+  [2]=>
+  int(64)
+  [3]=>
+  int(128)
+}
+string(8) "0000ffff"
+string(2) "04"
+int(1)
+array(2) {
+  [0]=>
+  bool(true)
+  [1]=>
+  bool(true)
+}
+bool(true)
+int(128)
+array(2) {
+  [0]=>
+  bool(false)
+  [1]=>
+  bool(false)
+}
+int(3)
+int(1024)
+string(2) "00"
+string(2) "01"
+bool(true)
+int(128)
+array(2) {
+  [0]=>
+  bool(false)
+  [1]=>
+  bool(false)
+}
+int(1)
+bool(false)
+bool(false)
+int(3)
+bool(true)
+int(128)
+array(2) {
+  [0]=>
+  bool(true)
+  [1]=>
+  bool(true)
+}
+Rotation test completed
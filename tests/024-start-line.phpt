@@ -0,0 +1,81 @@
+--TEST--
+SSD1306 start line scrolling test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+ssd1306_display();
+ssd1306_virtual_log(true);
+var_dump(ssd1306_get_start_line());
+
+// Each step is a single command byte
+var_dump(ssd1306_set_start_line(8));
+$log = ssd1306_virtual_log(true);
+var_dump(count($log), bin2hex($log[0]['bytes']), ssd1306_virtual_state()['start_line']);
+
+// Drawing follows the shift: panel row 0 is RAM row 8 and the bottom
+// rows wrap around to RAM rows 0 to 7
+ssd1306_draw_pixel(0, 0, SSD1306_WHITE);
+ssd1306_fill_rect(0, 56, 2, 8, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(1, 0, 1), page_bytes(0, 0, 2), ssd1306_get_pixel(0, 0), ssd1306_get_pixel(1, 60));
+
+// A fixed header above a scrolling area, set in one transaction
+ssd1306_clear_display();
+var_dump(ssd1306_scroll_vertical(4, 16, 48));
+$log = ssd1306_virtual_log(true);
+$state = ssd1306_virtual_state();
+var_dump(count($log), bin2hex($log[0]['bytes']), $state['scroll_area_top'], $state['scroll_area_rows']);
+
+ssd1306_draw_pixel(3, 10, SSD1306_WHITE);
+ssd1306_draw_pixel(3, 16, SSD1306_WHITE);
+ssd1306_draw_pixel(4, 63, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(1, 3, 1), page_bytes(2, 3, 2), ssd1306_get_pixel(4, 63));
+
+// The start line stays within the scroll area
+var_dump(@ssd1306_set_start_line(48), @ssd1306_scroll_vertical(0, 60, 8), @ssd1306_scroll_vertical(8, 0, 8));
+var_dump(ssd1306_set_start_line(0), ssd1306_get_start_line());
+
+ssd1306_end();
+
+// Short panels program a scroll area of their own height on first use
+$panel = new SSD1306\Display(0, 0x3C, 128, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+$panel->virtualLog(true);
+var_dump($panel->setStartLine(8), bin2hex($panel->virtualLog(true)[0]['bytes']));
+var_dump($panel->setStartLine(9), bin2hex($panel->virtualLog(true)[0]['bytes']));
+
+echo "Start line test completed\n";
+?>
+--EXPECT--
+int(0)
+bool(true)
+int(1)
+string(2) "48"
+int(8)
+string(2) "01"
+string(4) "ffff"
+int(1)
+int(1)
+bool(true)
+int(1)
+string(8) "a3103044"
+int(16)
+int(48)
+string(2) "04"
+string(4) "1008"
+int(1)
+bool(false)
+bool(false)
+bool(false)
+bool(true)
+int(0)
+bool(true)
+string(8) "a3002048"
+bool(true)
+string(2) "49"
+Start line test completed
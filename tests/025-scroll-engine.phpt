@@ -0,0 +1,105 @@
+--TEST--
+SSD1306 hardware scroll engine test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+function dump_log() {
+    foreach (ssd1306_virtual_log(true) as $txn) {
+        if ($txn['control'] == 0x40) {
+            printf("40 %d bytes\n", strlen($txn['bytes']));
+        } else {
+            printf("00 %s\n", bin2hex($txn['bytes']));
+        }
+    }
+}
+
+ssd1306_display();
+ssd1306_virtual_log(true);
+
+// The whole setup is one transaction: stop, parameters, start
+var_dump(ssd1306_start_scroll(SSD1306_SCROLL_LEFT, 2, 3, 2));
+dump_log();
+var_dump(ssd1306_virtual_state()['scrolling']);
+
+// Unchanged frames leave the scroll running
+ssd1306_display();
+var_dump(count(ssd1306_virtual_log()));
+
+// Updates stop the scroll, rewrite the pages it moved and restart it
+ssd1306_draw_pixel(10, 40, SSD1306_WHITE);
+ssd1306_display();
+dump_log();
+var_dump(ssd1306_virtual_state()['scrolling']);
+
+// After stopping, the next update rewrites the moved pages
+var_dump(ssd1306_stop_scroll());
+ssd1306_display();
+dump_log();
+var_dump(ssd1306_virtual_state()['scrolling']);
+
+// Column range and the slowest interval
+var_dump(ssd1306_start_scroll(SSD1306_SCROLL_RIGHT, 0, 7, 256, 0, -1, -1, 8, 119));
+dump_log();
+
+// Diagonal scroll over an area below a fixed header
+var_dump(ssd1306_start_scroll(SSD1306_SCROLL_DIAG_RIGHT, 0, 1, 25, 3, 16, 48));
+dump_log();
+$state = ssd1306_virtual_state();
+var_dump($state['scroll_area_top'], $state['scroll_area_rows']);
+
+// The fixed scrolls step every 5 frames, one row at a time
+var_dump(ssd1306_start_scroll_diag_left(0, 7));
+dump_log();
+
+// Parameters the engine does not have are rejected
+var_dump(@ssd1306_start_scroll(9));
+var_dump(@ssd1306_start_scroll(SSD1306_SCROLL_LEFT, 3, 2));
+var_dump(@ssd1306_start_scroll(SSD1306_SCROLL_LEFT, 0, 8));
+var_dump(@ssd1306_start_scroll(SSD1306_SCROLL_LEFT, 0, 7, 7));
+var_dump(@ssd1306_start_scroll(SSD1306_SCROLL_DIAG_LEFT, 0, 7, 5, 64));
+var_dump(@ssd1306_start_scroll(SSD1306_SCROLL_DIAG_LEFT, 0, 7, 5, 1, 0, 64, 0, 63));
+var_dump(@ssd1306_start_scroll(SSD1306_SCROLL_RIGHT, 0, 7, 5, 0, -1, -1, 64, 32));
+var_dump(count(ssd1306_virtual_log()));
+
+ssd1306_end();
+echo "Scroll engine test completed\n";
+?>
+--EXPECT--
+bool(true)
+00 2e270002070300ff2f
+bool(true)
+int(0)
+00 2e
+00 21007f220203
+40 256 bytes
+00 210a0a220505
+40 1 bytes
+00 2e270002070300ff2f
+bool(true)
+bool(true)
+00 2e
+00 21007f220203
+40 256 bytes
+bool(false)
+bool(true)
+00 2e260000030708772f
+bool(true)
+00 2ea310302900000601032f
+int(16)
+int(48)
+bool(true)
+00 2ea300402a00000007012f
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+int(0)
+Scroll engine test completed
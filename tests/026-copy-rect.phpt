@@ -0,0 +1,102 @@
+--TEST--
+SSD1306 copy_rect and scroll_region test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+// A copy three rows down straddles two pages; the source stays
+ssd1306_fill_rect(0, 0, 8, 8, SSD1306_WHITE);
+ssd1306_copy_rect(0, 0, 8, 8, 20, 3);
+ssd1306_display();
+var_dump(page_bytes(0, 20, 8), page_bytes(1, 20, 8), page_bytes(0, 0, 1));
+
+// Whole pages to whole pages
+ssd1306_copy_rect(0, 0, 8, 8, 40, 16);
+ssd1306_display();
+var_dump(page_bytes(2, 40, 2), page_bytes(2, 48, 1));
+
+// Overlapping source and destination
+ssd1306_clear_display();
+ssd1306_draw_pixel(0, 0, SSD1306_WHITE);
+ssd1306_draw_pixel(3, 0, SSD1306_WHITE);
+ssd1306_copy_rect(0, 0, 4, 1, 1, 0);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 5));
+
+// Scrolling moves pixels inside the region only and clears what it leaves
+ssd1306_clear_display();
+ssd1306_draw_pixel(5, 5, SSD1306_WHITE);
+ssd1306_draw_pixel(6, 20, SSD1306_WHITE);
+ssd1306_scroll_region(0, 0, 16, 16, 0, -4);
+var_dump(ssd1306_get_pixel(5, 1), ssd1306_get_pixel(5, 5), ssd1306_get_pixel(6, 20));
+
+ssd1306_scroll_region(0, 0, 16, 16, 2, 0, SSD1306_WHITE);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 2), page_bytes(1, 0, 2), page_bytes(0, 7, 1), page_bytes(0, 5, 1), page_bytes(1, 16, 1));
+
+// Vacated pixels are filled once, even where both moves leave them
+ssd1306_clear_display();
+ssd1306_scroll_region(0, 0, 8, 8, 1, 1, SSD1306_INVERSE);
+ssd1306_display();
+var_dump(page_bytes(0, 0, 3));
+
+// Destinations are clipped
+ssd1306_clear_display();
+ssd1306_fill_rect(0, 0, 8, 8, SSD1306_WHITE);
+ssd1306_set_clip(0, 0, 64, 64);
+ssd1306_copy_rect(0, 0, 8, 8, 60, 0);
+ssd1306_reset_clip();
+ssd1306_display();
+var_dump(page_bytes(0, 59, 6));
+
+// Rotated coordinates
+ssd1306_clear_display();
+ssd1306_set_rotation(1);
+ssd1306_draw_pixel(0, 0, SSD1306_WHITE);
+ssd1306_copy_rect(0, 0, 1, 1, 10, 20);
+ssd1306_display();
+var_dump(page_bytes(1, 107, 1), ssd1306_get_pixel(10, 20));
+ssd1306_set_rotation(0);
+
+// Empty and far away rectangles do nothing
+ssd1306_clear_display();
+ssd1306_display();
+ssd1306_virtual_log(true);
+ssd1306_copy_rect(0, 0, 0, 8, 10, 10);
+ssd1306_copy_rect(0, 0, 8, 8, PHP_INT_MIN, PHP_INT_MAX);
+ssd1306_scroll_region(200, 0, 8, 8, 1, 1, SSD1306_WHITE);
+ssd1306_display();
+var_dump(count(ssd1306_virtual_log()));
+
+var_dump(method_exists('SSD1306\Display', 'copyRect'), method_exists('SSD1306\Display', 'scrollRegion'));
+
+ssd1306_end();
+echo "Region move test completed\n";
+?>
+--EXPECT--
+string(16) "f8f8f8f8f8f8f8f8"
+string(16) "0707070707070707"
+string(2) "ff"
+string(4) "ffff"
+string(2) "00"
+string(10) "0101000001"
+int(1)
+int(0)
+int(1)
+string(4) "ffff"
+string(4) "ffff"
+string(2) "02"
+string(2) "00"
+string(2) "00"
+string(6) "ff0101"
+string(12) "00ffffffff00"
+string(2) "04"
+int(1)
+int(0)
+bool(true)
+bool(true)
+Region move test completed
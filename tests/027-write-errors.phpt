@@ -0,0 +1,72 @@
+--TEST--
+SSD1306 bus write failure test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+require __DIR__ . '/ssd1306.inc';
+
+virtual_begin();
+
+ssd1306_display();
+ssd1306_virtual_log(true);
+
+// A failed write fails the update and never reaches the panel
+ssd1306_draw_pixel(10, 10, SSD1306_WHITE);
+var_dump(ssd1306_virtual_fail(1));
+var_dump(ssd1306_display());
+$stats = ssd1306_stats();
+var_dump($stats['write_errors'], $stats['flush_errors']);
+var_dump(ssd1306_virtual_state()['failed'], count(ssd1306_virtual_log()), page_bytes(1, 10, 1));
+
+// The next update sends what did not arrive
+var_dump(ssd1306_display(), page_bytes(1, 10, 1));
+
+// Command batches report failures until the bus recovers
+var_dump(ssd1306_virtual_fail(-1));
+var_dump(ssd1306_commands([0xAE]), ssd1306_commands([0xAE]), ssd1306_virtual_state()['display_on']);
+var_dump(ssd1306_virtual_fail(0));
+var_dump(ssd1306_commands([0xAE]), ssd1306_virtual_state()['display_on']);
+
+// Background updates report the failure through wait() and completions()
+$stream = ssd1306_completion_stream();
+ssd1306_draw_pixel(20, 20, SSD1306_WHITE);
+ssd1306_virtual_fail(1);
+var_dump(ssd1306_display_async());
+var_dump(ssd1306_wait());
+$done = ssd1306_completions();
+var_dump(count($done), $done[0]['op'] == SSD1306_OP_DISPLAY, $done[0]['ok'], $done[0]['errno']);
+
+// The next update resends the frame the failed one did not deliver
+var_dump(page_bytes(2, 20, 1), ssd1306_display(), page_bytes(2, 20, 1));
+
+ssd1306_end();
+echo "Write error test completed\n";
+?>
+--EXPECT--
+bool(true)
+bool(false)
+int(1)
+int(1)
+int(1)
+int(0)
+string(2) "00"
+bool(true)
+string(2) "04"
+bool(true)
+bool(false)
+bool(false)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(true)
+bool(false)
+int(1)
+bool(true)
+bool(false)
+int(5)
+string(2) "00"
+bool(true)
+string(2) "10"
+Write error test completed
@@ -0,0 +1,58 @@
+--TEST--
+SSD1306 display size validation test
+--SKIPIF--
+<?php if (!extension_loaded('ssd1306')) print 'skip'; ?>
+--FILE--
+<?php
+// Widths must fill whole bytes of the packed buffer formats
+var_dump(@ssd1306_begin(1, 0x3C, 4, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+var_dump(@ssd1306_begin(1, 0x3C, 100, 64, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+var_dump(@ssd1306_begin(1, 0x3C, 128, 20, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+
+// Heights stop at the controller's 64 rows
+var_dump(@ssd1306_begin(1, 0x3C, 128, 128, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+var_dump(@ssd1306_pbegin(1, 0x3C, 0, 64, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+var_dump(@ssd1306_shared_begin('ssd1306-size-test', 100, 64));
+try {
+    $panel = @new SSD1306\Display(1, 0x3C, 4, 32, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL);
+} catch (RuntimeException $e) {
+    echo "Display rejected\n";
+}
+
+// A narrower panel that is not a multiple of 16 wide
+var_dump(ssd1306_begin(1, 0x3C, 120, 64, SSD1306_SWITCHCAPVCC, SSD1306_TRANSPORT_VIRTUAL));
+var_dump(ssd1306_get_width());
+
+ssd1306_draw_pixel(119, 0, SSD1306_WHITE);
+ssd1306_draw_pixel(0, 63, SSD1306_WHITE);
+$rows = ssd1306_get_buffer(SSD1306_FORMAT_ROW);
+$xbm = ssd1306_get_buffer(SSD1306_FORMAT_XBM);
+var_dump(strlen($rows), bin2hex($rows[14]), bin2hex($rows[945]), strlen($xbm), bin2hex($xbm[14]));
+
+ssd1306_clear_display();
+var_dump(ssd1306_set_buffer($rows, 0, SSD1306_FORMAT_ROW), ssd1306_get_pixel(119, 0), ssd1306_get_pixel(0, 63));
+var_dump(ssd1306_get_buffer(SSD1306_FORMAT_ROW) === $rows);
+
+ssd1306_end();
+echo "Display size test completed\n";
+?>
+--EXPECT--
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+Display rejected
+bool(true)
+int(120)
+int(960)
+string(2) "01"
+string(2) "80"
+int(960)
+string(2) "80"
+bool(true)
+int(1)
+int(1)
+bool(true)
+Display size test completed